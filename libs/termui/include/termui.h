@@ -2,7 +2,8 @@
  * termui - Shared Terminal UI Library for jcaldwell-labs projects
  *
  * A minimal terminal UI library providing common patterns:
- * - Terminal initialization/cleanup (ncurses)
+ * - Terminal initialization/cleanup, on one of three backends: ncurses,
+ *   direct ANSI output, or a headless in-memory screen for tests
  * - Frame buffer for double-buffered rendering
  * - Input action polling
  * - Color pair management
@@ -28,16 +29,17 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Version */
-#define TERMUI_VERSION_MAJOR 1
+/* Version (the major number changes with the ABI, e.g. termui_config_t) */
+#define TERMUI_VERSION_MAJOR 2
 #define TERMUI_VERSION_MINOR 0
 #define TERMUI_VERSION_PATCH 0
-#define TERMUI_VERSION "1.0.0"
+#define TERMUI_VERSION "2.0.0"
 
 /* Error codes */
 typedef enum {
@@ -60,6 +62,15 @@ typedef enum {
     TERMUI_COLOR_MAGENTA = 7
 } termui_color_t;
 
+/* Box drawing styles */
+typedef enum {
+    TERMUI_BOX_ASCII = 0,     /* + - | */
+    TERMUI_BOX_LIGHT,         /* Unicode light lines */
+    TERMUI_BOX_HEAVY,         /* Unicode heavy lines */
+    TERMUI_BOX_DOUBLE,        /* Unicode double lines */
+    TERMUI_BOX_ROUNDED        /* Light lines with rounded corners */
+} termui_box_style_t;
+
 /* Input actions */
 typedef enum {
     TERMUI_INPUT_NONE = 0,
@@ -75,16 +86,215 @@ typedef enum {
     TERMUI_INPUT_RESIZE       /* Terminal resized */
 } termui_input_t;
 
+/* Input event from termui_input_drain */
+typedef struct {
+    termui_input_t input;     /* Action (TERMUI_INPUT_NONE in raw_keys mode) */
+    int key;                  /* Raw key code of the first occurrence */
+    int count;                /* Occurrences folded into this event (>= 1) */
+    uint64_t time_ns;         /* CLOCK_MONOTONIC time the first occurrence was read */
+} termui_input_event_t;
+
+/* termui_input_drain flags */
+#define TERMUI_DRAIN_COALESCE 0x1 /* Fold repeated movement actions into one event */
+
+/* Readiness flags for watched file descriptors */
+#define TERMUI_FD_READ  0x1
+#define TERMUI_FD_WRITE 0x2
+#define TERMUI_FD_ERROR 0x4       /* Reported only: error or invalid fd */
+
+/* Watched fd callback; events holds the TERMUI_FD_* flags that are ready */
+typedef void (*termui_fd_fn)(int fd, int events, void *user);
+
+/* Timer callback */
+typedef void (*termui_timer_fn)(void *user);
+
+/* Output backends */
+typedef enum {
+    TERMUI_BACKEND_NCURSES = 0, /* Render through ncurses (default) */
+    TERMUI_BACKEND_ANSI,        /* Encode escape sequences directly, one write per frame */
+    TERMUI_BACKEND_HEADLESS     /* No tty: ANSI output drives an in-memory screen */
+} termui_backend_t;
+
+/* Extended color: default, a 256-color palette index or 24-bit RGB */
+typedef uint32_t termui_xcolor_t;
+
+#define TERMUI_XCOLOR_DEFAULT      0x00000000u
+#define TERMUI_XCOLOR_INDEX(n)     (0x01000000u | ((uint32_t)(n) & 0xffu))
+#define TERMUI_XCOLOR_RGB(r, g, b) (0x02000000u | ((uint32_t)(r) & 0xffu) << 16 | \
+                                    ((uint32_t)(g) & 0xffu) << 8 | ((uint32_t)(b) & 0xffu))
+
+/* Cell attributes */
+#define TERMUI_ATTR_BOLD      0x1
+#define TERMUI_ATTR_UNDERLINE 0x2
+#define TERMUI_ATTR_REVERSE   0x4
+
+/* Full cell style */
+typedef struct {
+    termui_xcolor_t fg;
+    termui_xcolor_t bg;
+    unsigned int attrs;       /* TERMUI_ATTR_* */
+} termui_style_t;
+
+/* Distinct styles a program can use; further ones keep only a basic
+ * foreground color */
+#define TERMUI_STYLE_LIMIT 32768
+
+/* Color depth extended colors are reduced to */
+typedef enum {
+    TERMUI_COLORS_AUTO = 0,     /* From COLORTERM/TERM (ANSI), truecolor (headless), 16 (ncurses) */
+    TERMUI_COLORS_16,
+    TERMUI_COLORS_256,
+    TERMUI_COLORS_TRUECOLOR
+} termui_color_mode_t;
+
 /* Configuration */
 typedef struct {
     bool colors_enabled;      /* Enable color support (default: true) */
     bool mouse_enabled;       /* Enable mouse events (default: false) */
     bool raw_keys;            /* Don't translate keys (default: false) */
+    termui_backend_t backend; /* Output backend (default: TERMUI_BACKEND_NCURSES) */
+    int headless_width;       /* Headless screen size (default: 80x24) */
+    int headless_height;
+    termui_color_mode_t color_mode; /* Extended color depth (default: TERMUI_COLORS_AUTO) */
 } termui_config_t;
 
+/* SIMD level used by the cell kernels */
+typedef enum {
+    TERMUI_SIMD_SCALAR = 0,
+    TERMUI_SIMD_SSE2,
+    TERMUI_SIMD_AVX2
+} termui_simd_level_t;
+
 /* Frame buffer - opaque type */
 typedef struct termui_buffer termui_buffer_t;
 
+/* Layer compositor - opaque types */
+typedef struct termui_compositor termui_compositor_t;
+typedef struct termui_layer termui_layer_t;
+
+/* Retained display list - opaque types */
+typedef struct termui_display_list termui_display_list_t;
+typedef struct termui_group termui_group_t;
+
+/* A point for polylines and polygons */
+typedef struct {
+    int x, y;
+} termui_point_t;
+
+/* Sub-cell canvas - opaque type */
+typedef struct termui_canvas termui_canvas_t;
+
+/* Tiled drawing - opaque type */
+typedef struct termui_tiles termui_tiles_t;
+
+/* Gamepad - opaque type */
+typedef struct termui_gamepad termui_gamepad_t;
+
+/* Gamepad state */
+typedef struct {
+    bool connected;           /* False once the device is unplugged */
+    int axis_x, axis_y;       /* Left stick, -1000..1000, deadzone applied */
+    int axis_rx, axis_ry;     /* Right stick, -1000..1000, deadzone applied */
+    int hat_x, hat_y;         /* D-pad: -1, 0 or 1 */
+    uint16_t buttons;         /* Bit n set while button n is held */
+} termui_gamepad_state_t;
+
+/* Output queue counters */
+typedef struct {
+    size_t pending_bytes;     /* Rendered bytes the terminal has not accepted yet */
+    size_t tty_queued_bytes;  /* Accepted but still in the kernel tty queue (TIOCOUTQ) */
+    uint64_t bytes_encoded;   /* Frame bytes produced since termui_init */
+    uint64_t bytes_written;   /* Bytes accepted since termui_init */
+    uint64_t write_calls;     /* write() syscalls on the output since termui_init */
+    uint64_t frames_sent;     /* Renders that sent anything */
+    uint64_t frames_deferred; /* Renders held back because output was still queued */
+    uint64_t frames_replaced; /* Queued frames replaced, unsent, by a newer one */
+} termui_output_stats_t;
+
+/* Headless screen counters */
+typedef struct {
+    uint64_t bytes;           /* Bytes presented */
+    uint64_t sequences;       /* Escape sequences */
+    uint64_t cursor_moves;    /* Cursor positioning sequences, CR and LF */
+    uint64_t color_changes;   /* SGR sequences */
+    uint64_t glyphs;          /* Characters drawn */
+    uint64_t frames;          /* Synchronized updates completed */
+} termui_headless_stats_t;
+
+/* Frames kept for termui_stats_t percentiles */
+#define TERMUI_STATS_WINDOW 128
+
+/* Frame statistics (see termui_stats_enable) */
+typedef struct {
+    uint64_t frames;          /* Frames presented since enabled or reset */
+    uint64_t input_events;    /* Input events read */
+    uint64_t missed_deadlines; /* Frame loop update/render deadlines missed */
+
+    /* Last presented frame */
+    uint64_t render_ns;       /* Time spent in render */
+    uint32_t cells_changed;   /* Cells sent */
+    uint32_t bytes;           /* Bytes produced (ANSI and headless backends) */
+    uint32_t writes;          /* write() calls since the previous frame */
+
+    /* Over the last window frames */
+    int window;               /* Frames sampled, up to TERMUI_STATS_WINDOW */
+    uint64_t render_ns_p50;
+    uint64_t render_ns_p95;
+    uint64_t render_ns_p99;
+    uint64_t render_ns_max;
+    double avg_cells_changed;
+    double avg_bytes;
+} termui_stats_t;
+
+/* Corner for termui_stats_draw_hud */
+typedef enum {
+    TERMUI_HUD_TOP_LEFT = 0,
+    TERMUI_HUD_TOP_RIGHT,
+    TERMUI_HUD_BOTTOM_LEFT,
+    TERMUI_HUD_BOTTOM_RIGHT
+} termui_hud_corner_t;
+
+/* Render thread - opaque type */
+typedef struct termui_render_thread termui_render_thread_t;
+
+/* Render thread counters */
+typedef struct {
+    uint64_t submitted;       /* Frames handed over */
+    uint64_t presented;       /* Frames sent to the terminal */
+    uint64_t dropped;         /* Frames replaced by a newer one before presenting */
+} termui_render_thread_stats_t;
+
+/* Frame loop - opaque type */
+typedef struct termui_loop termui_loop_t;
+
+/* Frame loop configuration */
+typedef struct {
+    int update_hz;            /* Fixed update rate (default: 60) */
+    int render_hz;            /* Render rate cap (default: 60) */
+    int max_catchup;          /* Updates run per wakeup before dropping time (default: 5) */
+    bool adaptive;            /* Lower the render rate when output backs up (default: true) */
+    int min_render_hz;        /* Floor for the adaptive render rate (default: 2) */
+} termui_loop_config_t;
+
+/* Frame loop counters */
+typedef struct {
+    uint64_t updates;         /* Update ticks run */
+    uint64_t renders;         /* Frames presented */
+    uint64_t skipped_renders; /* Render slots with nothing to send */
+    uint64_t missed_updates;  /* Update ticks run late or dropped */
+    uint64_t missed_renders;  /* Frames started a whole period late */
+    double render_hz;         /* Current render rate (below the cap while adaptive pacing backs off) */
+    double drain_rate;        /* Estimated output throughput, bytes/s (0 until measured) */
+} termui_loop_stats_t;
+
+/* Fixed-rate update callback; dt is the update period in seconds
+ * Return false to stop the loop */
+typedef bool (*termui_update_fn)(void *user, double dt);
+
+/* Draw callback; alpha is the fraction of an update period elapsed
+ * since the last update, for interpolation */
+typedef void (*termui_draw_fn)(void *user, double alpha);
+
 /*
  * Core Functions
  */
@@ -93,7 +303,9 @@ typedef struct termui_buffer termui_buffer_t;
 termui_config_t termui_default_config(void);
 
 /* Initialize terminal (call once at startup)
- * Pass NULL for default configuration */
+ * Pass NULL for default configuration. The ANSI backend restores the
+ * tty on SIGINT, SIGTERM and SIGTSTP, and takes it back on SIGCONT with
+ * a TERMUI_INPUT_RESIZE so the app repaints */
 int termui_init(const termui_config_t *config);
 
 /* Cleanup terminal (call before exit) */
@@ -105,7 +317,11 @@ bool termui_is_initialized(void);
 /* Get terminal size */
 void termui_get_size(int *width, int *height);
 
-/* Check and handle terminal resize
+/* Color depth in use (resolved from TERMUI_COLORS_AUTO at init) */
+termui_color_mode_t termui_get_color_mode(void);
+
+/* Check and handle terminal resize; the screen keeps the last frame
+ * when it can, otherwise it is cleared and buffers repaint in full
  * Returns true if terminal was resized */
 bool termui_check_resize(void);
 
@@ -115,6 +331,9 @@ const char* termui_version(void);
 /* Get error string for error code */
 const char* termui_error_string(int code);
 
+/* Get the SIMD level selected for buffer kernels on this CPU */
+termui_simd_level_t termui_simd_level(void);
+
 /*
  * Frame Buffer Functions
  */
@@ -125,6 +344,12 @@ termui_buffer_t* termui_buffer_create(int width, int height);
 /* Destroy a frame buffer */
 void termui_buffer_destroy(termui_buffer_t *buf);
 
+/* Resize a buffer in place, keeping the top-left content; new cells are
+ * blank. After termui_check_resize, resizing the presented buffer to the
+ * terminal sends only uncovered and changed cells. Tiles are re-split.
+ * Returns TERMUI_NOMEM if storage cannot grow */
+int termui_buffer_resize(termui_buffer_t *buf, int width, int height);
+
 /* Clear buffer to spaces */
 void termui_buffer_clear(termui_buffer_t *buf);
 
@@ -137,6 +362,57 @@ void termui_buffer_draw_char(termui_buffer_t *buf, int x, int y, char c, termui_
 /* Draw a string at position with color */
 void termui_buffer_draw_string(termui_buffer_t *buf, int x, int y, const char *str, termui_color_t color);
 
+/* Draw UTF-8 text at position with color
+ * Double-width glyphs take two cells; combining marks join the preceding
+ * glyph. Drawing stops at the right edge of the buffer */
+void termui_buffer_draw_utf8(termui_buffer_t *buf, int x, int y, const char *str, termui_color_t color);
+
+/* Draw UTF-8 text in a full style (extended colors and attributes),
+ * reduced to the terminal's color depth when presented */
+void termui_buffer_draw_styled(termui_buffer_t *buf, int x, int y, const char *str,
+                               const termui_style_t *style);
+
+/* Restyle a rectangle, keeping its glyphs */
+void termui_buffer_set_style(termui_buffer_t *buf, int x, int y, int width, int height,
+                             const termui_style_t *style);
+
+/* Draw at most len bytes of str (stopping at a NUL) as draw_string does;
+ * bytes past the right edge are never read */
+void termui_buffer_draw_text_n(termui_buffer_t *buf, int x, int y, const char *str, size_t len,
+                               termui_color_t color);
+
+/* Fill a rectangle with one character */
+void termui_buffer_fill_rect(termui_buffer_t *buf, int x, int y, int width, int height,
+                             char c, termui_color_t color);
+
+/* Draw a line from (x0, y0) to (x1, y1) inclusive, clipped before it is
+ * rasterized: off-screen parts cost nothing */
+void termui_buffer_draw_line(termui_buffer_t *buf, int x0, int y0, int x1, int y1,
+                             char c, termui_color_t color);
+
+/* Draw lines joining count points in order */
+void termui_buffer_draw_polyline(termui_buffer_t *buf, const termui_point_t *points, int count,
+                                 char c, termui_color_t color);
+
+/* Draw a circle outline */
+void termui_buffer_draw_circle(termui_buffer_t *buf, int cx, int cy, int radius,
+                               char c, termui_color_t color);
+
+/* Fill a polygon (even-odd rule), edges included */
+void termui_buffer_fill_polygon(termui_buffer_t *buf, const termui_point_t *points, int count,
+                                char c, termui_color_t color);
+
+/* Copy the width x height cells at (sx, sy) of src to (dx, dy) of dst,
+ * clipped to both. src may be dst, and the rectangles may overlap */
+void termui_buffer_blit(termui_buffer_t *dst, int dx, int dy, const termui_buffer_t *src,
+                        int sx, int sy, int width, int height);
+
+/* Draw a single Unicode codepoint at position with color */
+void termui_buffer_draw_codepoint(termui_buffer_t *buf, int x, int y, uint32_t codepoint, termui_color_t color);
+
+/* Get the display width of UTF-8 text in cells */
+int termui_utf8_width(const char *str);
+
 /* Draw a horizontal line */
 void termui_buffer_draw_hline(termui_buffer_t *buf, int x, int y, int length, char c, termui_color_t color);
 
@@ -146,9 +422,343 @@ void termui_buffer_draw_vline(termui_buffer_t *buf, int x, int y, int length, ch
 /* Draw a box outline */
 void termui_buffer_draw_box(termui_buffer_t *buf, int x, int y, int width, int height, termui_color_t color);
 
-/* Render buffer to terminal */
+/* Draw a box outline with the given line style */
+void termui_buffer_draw_box_style(termui_buffer_t *buf, int x, int y, int width, int height,
+                                  termui_box_style_t style, termui_color_t color);
+
+/* Render buffer to terminal
+ * Only cells that changed since this buffer was last presented are sent;
+ * returns without touching the terminal when nothing changed */
 void termui_buffer_render(const termui_buffer_t *buf);
 
+/* Force the next render to repaint every cell
+ * Use after drawing to the terminal outside of termui */
+void termui_buffer_invalidate(termui_buffer_t *buf);
+
+/* Check whether the next render has anything to send */
+bool termui_buffer_is_dirty(const termui_buffer_t *buf);
+
+/* Find which columns of each row differ from the frame last presented
+ * first and last must hold one int per buffer row; they receive the first
+ * and last changed column, or -1 for unchanged rows.
+ * Returns the number of changed rows */
+int termui_buffer_diff_rows(const termui_buffer_t *buf, int *first, int *last);
+
+/* Check whether any cell in a region differs from the frame last presented */
+bool termui_buffer_region_changed(const termui_buffer_t *buf, int x, int y, int width, int height);
+
+/* Bytes of rendered output still queued for the terminal (ANSI backend)
+ * While non-zero, a render replaces the queued frame if none of it has
+ * been written, else it is deferred and re-diffed once the queue drains */
+size_t termui_output_pending(void);
+
+/* Wait up to timeout_ms (-1: forever) for queued output, including a
+ * deferred frame, to reach the terminal. Returns true once drained */
+bool termui_output_flush(int timeout_ms);
+
+/* Get output queue counters */
+void termui_output_get_stats(termui_output_stats_t *stats);
+
+/*
+ * Frame Statistics
+ *
+ * Off by default; while off, render does not even read the clock.
+ */
+
+/* Start (resetting the counters) or stop collecting frame statistics */
+void termui_stats_enable(bool enabled);
+
+/* Zero the counters and the percentile window */
+void termui_stats_reset(void);
+
+/* Get the last frame's figures, totals and rolling percentiles */
+void termui_stats_get(termui_stats_t *stats);
+
+/* Draw a 30x6 overlay with the current stats into a corner of buf
+ * Call after drawing the frame, before rendering it */
+void termui_stats_draw_hud(termui_buffer_t *buf, termui_hud_corner_t corner);
+
+/*
+ * Headless Backend
+ *
+ * With TERMUI_BACKEND_HEADLESS, termui needs no tty: frames are encoded
+ * exactly as for the ANSI backend and interpreted by an in-memory
+ * terminal, so render paths can be checked and benchmarked in CI.
+ */
+
+/* Read back a screen cell; codepoint is 0 for the right half of a wide
+ * glyph. Returns false if out of range or not headless */
+bool termui_headless_get_cell(int x, int y, uint32_t *codepoint, termui_color_t *color);
+
+/* Read the full style of a headless screen cell (extended colors as the
+ * terminal was sent them). Returns false if out of range */
+bool termui_headless_get_style(int x, int y, termui_style_t *style);
+
+/* Copy row y as UTF-8 into out (NUL-terminated, truncated to size)
+ * Returns the length written */
+size_t termui_headless_get_row(int y, char *out, size_t size);
+
+/* Get or reset the counters of what was sent to the screen */
+void termui_headless_get_stats(termui_headless_stats_t *stats);
+void termui_headless_reset_stats(void);
+
+/* Resize the screen, keeping its contents like a terminal would;
+ * reported as TERMUI_INPUT_RESIZE */
+int termui_headless_resize(int width, int height);
+
+/* Accept at most bytes more output, then stop reading like a congested
+ * terminal until called again; the rest stays queued as pending output.
+ * -1 (the default) accepts everything */
+int termui_headless_limit_output(long bytes);
+
+/* Queue raw terminal input (keys, escape sequences) for the input
+ * functions to decode. Call from the thread that reads input */
+int termui_headless_send_input(const char *bytes, size_t len);
+
+/*
+ * Layer Compositor
+ *
+ * Composites a z-ordered stack of layer buffers into a target buffer.
+ * Cells drawn with a '\0' glyph are transparent. Only rectangles that
+ * changed in some layer (or that a layer moved out of or into) are
+ * recomposited. Layer buffers are owned by the compositor; draw into them
+ * with the normal buffer functions but do not render them directly.
+ */
+
+/* Create a compositor drawing into target (not owned) */
+termui_compositor_t* termui_compositor_create(termui_buffer_t *target);
+
+/* Destroy a compositor and all of its layers */
+void termui_compositor_destroy(termui_compositor_t *comp);
+
+/* Add a transparent layer at offset (x, y) with stacking order z
+ * Higher z is drawn on top; equal z stacks in insertion order */
+termui_layer_t* termui_compositor_add_layer(termui_compositor_t *comp, int x, int y,
+                                            int width, int height, int z);
+
+/* Remove and destroy a layer */
+void termui_compositor_remove_layer(termui_compositor_t *comp, termui_layer_t *layer);
+
+/* Recomposite damaged areas into the target buffer
+ * Returns the number of target cells recomposited */
+int termui_compositor_compose(termui_compositor_t *comp);
+
+/* Force the next compose to recomposite the whole target */
+void termui_compositor_invalidate(termui_compositor_t *comp);
+
+/* Get the buffer to draw a layer's contents into */
+termui_buffer_t* termui_layer_buffer(termui_layer_t *layer);
+
+/* Clear a layer to fully transparent */
+void termui_layer_clear(termui_layer_t *layer);
+
+/* Move a layer within the target */
+void termui_layer_set_offset(termui_layer_t *layer, int x, int y);
+
+/* Show or hide a layer */
+void termui_layer_set_visible(termui_layer_t *layer, bool visible);
+
+/* Change a layer's stacking order */
+void termui_layer_set_z(termui_compositor_t *comp, termui_layer_t *layer, int z);
+
+/*
+ * Retained Display List
+ *
+ * Records named groups of draw calls, each owning a rectangle of a
+ * target buffer, and redraws a group only when its version key changes.
+ * Build a group's contents between termui_group_begin (which returns
+ * false, and records nothing, when the key is unchanged) and the next
+ * termui_display_list_replay. Replay clears the rectangles of changed
+ * groups and redraws them, clipped, in group-local coordinates; the
+ * rest of the target is not touched. Groups are stacked in creation
+ * order.
+ */
+
+/* Create a display list drawing into target (not owned) */
+termui_display_list_t* termui_display_list_create(termui_buffer_t *target);
+
+/* Destroy a display list and its groups (the target keeps its cells) */
+void termui_display_list_destroy(termui_display_list_t *list);
+
+/* Find or add the group called name at (x, y, width, height); a changed
+ * rectangle moves the group and redraws what it uncovered */
+termui_group_t* termui_display_list_group(termui_display_list_t *list, const char *name,
+                                          int x, int y, int width, int height);
+
+/* Remove a group, clearing its rectangle */
+void termui_display_list_remove(termui_display_list_t *list, termui_group_t *group);
+
+/* Redraw every group on the next replay (e.g. after clearing the target) */
+void termui_display_list_invalidate(termui_display_list_t *list);
+
+/* Redraw changed groups into the target; returns how many were drawn */
+int termui_display_list_replay(termui_display_list_t *list);
+
+/* Start re-recording group if key differs from its last key. Returns
+ * false if unchanged: skip building it, the recording is kept */
+bool termui_group_begin(termui_group_t *group, uint64_t key);
+
+/* Recorded draw calls, as the termui_buffer_* ones but relative to the
+ * group's origin */
+void termui_group_draw_char(termui_group_t *group, int x, int y, char c, termui_color_t color);
+void termui_group_draw_string(termui_group_t *group, int x, int y, const char *str, termui_color_t color);
+void termui_group_draw_text_n(termui_group_t *group, int x, int y, const char *str, size_t len,
+                              termui_color_t color);
+void termui_group_fill_rect(termui_group_t *group, int x, int y, int width, int height,
+                            char c, termui_color_t color);
+void termui_group_draw_utf8(termui_group_t *group, int x, int y, const char *str, termui_color_t color);
+void termui_group_draw_styled(termui_group_t *group, int x, int y, const char *str,
+                              const termui_style_t *style);
+void termui_group_draw_codepoint(termui_group_t *group, int x, int y, uint32_t codepoint, termui_color_t color);
+void termui_group_draw_hline(termui_group_t *group, int x, int y, int length, char c, termui_color_t color);
+void termui_group_draw_vline(termui_group_t *group, int x, int y, int length, char c, termui_color_t color);
+void termui_group_draw_box(termui_group_t *group, int x, int y, int width, int height, termui_color_t color);
+void termui_group_draw_box_style(termui_group_t *group, int x, int y, int width, int height,
+                                 termui_box_style_t style, termui_color_t color);
+void termui_group_set_style(termui_group_t *group, int x, int y, int width, int height,
+                            const termui_style_t *style);
+
+/*
+ * Sub-cell Canvas
+ *
+ * A pixel grid drawn with braille (2x4 pixels per cell) or quadrant
+ * block (2x2) glyphs. Pixels are bits; drawing converts only the cells
+ * changed since the last draw. Each cell takes the color of the last
+ * pixel set in it.
+ */
+
+typedef enum {
+    TERMUI_CANVAS_BRAILLE,      /* U+2800..U+28FF: 2x4 pixels per cell */
+    TERMUI_CANVAS_QUADRANT      /* U+2580..U+259F blocks: 2x2 pixels per cell */
+} termui_canvas_mode_t;
+
+/* Create a canvas covering columns x rows cells, all pixels off */
+termui_canvas_t* termui_canvas_create(int columns, int rows, termui_canvas_mode_t mode);
+
+/* Destroy a canvas */
+void termui_canvas_destroy(termui_canvas_t *canvas);
+
+/* Size in pixels */
+void termui_canvas_get_size(const termui_canvas_t *canvas, int *width, int *height);
+
+/* Turn pixel (x, y) on in color, or off; out-of-range pixels are ignored */
+void termui_canvas_set(termui_canvas_t *canvas, int x, int y, termui_color_t color);
+void termui_canvas_unset(termui_canvas_t *canvas, int x, int y);
+
+/* Whether pixel (x, y) is on */
+bool termui_canvas_get(const termui_canvas_t *canvas, int x, int y);
+
+/* Turn every pixel off */
+void termui_canvas_clear(termui_canvas_t *canvas);
+
+/* Shapes in pixels, as the termui_buffer_ ones */
+void termui_canvas_draw_line(termui_canvas_t *canvas, int x0, int y0, int x1, int y1, termui_color_t color);
+void termui_canvas_draw_polyline(termui_canvas_t *canvas, const termui_point_t *points, int count,
+                                 termui_color_t color);
+void termui_canvas_draw_circle(termui_canvas_t *canvas, int cx, int cy, int radius, termui_color_t color);
+void termui_canvas_fill_polygon(termui_canvas_t *canvas, const termui_point_t *points, int count,
+                                termui_color_t color);
+
+/* Write the cells changed since the last draw into buf with the canvas
+ * at cell (x, y), clipped. Drawing somewhere else redraws every cell */
+void termui_canvas_draw(termui_canvas_t *canvas, termui_buffer_t *buf, int x, int y);
+
+/* Redraw every cell on the next draw (e.g. after clearing the buffer) */
+void termui_canvas_invalidate(termui_canvas_t *canvas);
+
+/*
+ * Tiled Drawing
+ *
+ * Splits a buffer into a grid of tiles that different threads can draw
+ * into at the same time, one thread per tile, without locking. Each tile
+ * is a buffer handle clipped to its rectangle: use the normal drawing
+ * functions on it with tile-local coordinates. Damage is tracked per tile
+ * and folded into the buffer when it is rendered, so render (or query the
+ * buffer's damage) only after every drawing thread has finished the
+ * frame. Do not draw into the buffer itself while tiles are being drawn.
+ *
+ * Tile handles cannot be rendered, destroyed, submitted to a render
+ * thread or used as a compositor target. Glyphs and styles may be
+ * interned from any thread.
+ */
+
+/* Split buf into columns x rows tiles of near-equal size (rows x 1 for
+ * row bands). Returns NULL if buf already has tiles */
+termui_tiles_t* termui_tiles_create(termui_buffer_t *buf, int columns, int rows);
+
+/* Destroy the tile handles, keeping what was drawn; the buffer stays */
+void termui_tiles_destroy(termui_tiles_t *tiles);
+
+/* Number of tiles (columns * rows, after clamping to the buffer size) */
+int termui_tiles_count(const termui_tiles_t *tiles);
+
+/* Buffer handle of tile index (row-major) */
+termui_buffer_t* termui_tiles_get(termui_tiles_t *tiles, int index);
+
+/* Rectangle of tile index within the buffer; false if out of range */
+bool termui_tiles_get_rect(const termui_tiles_t *tiles, int index, int *x, int *y, int *width, int *height);
+
+/*
+ * Render Thread
+ *
+ * Optional thread that owns terminal output. Submitting a frame copies
+ * it and returns at once; the thread presents the newest submitted frame
+ * and drops any that were replaced before it got to them. While it runs,
+ * do not call termui_buffer_render yourself.
+ */
+
+/* Start a render thread (after termui_init) */
+termui_render_thread_t* termui_render_thread_start(void);
+
+/* Present any pending frame, then stop and free the thread
+ * Call before termui_cleanup */
+void termui_render_thread_stop(termui_render_thread_t *rt);
+
+/* Hand a finished frame to the render thread
+ * The frame is copied; keep drawing into it as usual */
+int termui_render_thread_submit(termui_render_thread_t *rt, const termui_buffer_t *frame);
+
+/* Get submitted/presented/dropped frame counts */
+void termui_render_thread_get_stats(termui_render_thread_t *rt, termui_render_thread_stats_t *stats);
+
+/*
+ * Frame Loop
+ *
+ * Runs update at a fixed rate and draw at a capped rate, sleeping until
+ * the next deadline in between. After draw, the screen buffer is
+ * rendered only if it is dirty. Updates that fall behind are caught up
+ * to max_catchup per wakeup; the rest are dropped and counted as missed.
+ */
+
+/* Get default loop configuration */
+termui_loop_config_t termui_loop_default_config(void);
+
+/* Create a loop that renders screen after each draw (not owned)
+ * Pass NULL config for defaults; pass NULL screen if draw renders itself */
+termui_loop_t* termui_loop_create(const termui_loop_config_t *config, termui_buffer_t *screen);
+
+/* Destroy a loop */
+void termui_loop_destroy(termui_loop_t *loop);
+
+/* Change the buffer rendered after draw (e.g. after a resize) */
+void termui_loop_set_screen(termui_loop_t *loop, termui_buffer_t *screen);
+
+/* Run until update returns false or termui_loop_stop is called */
+int termui_loop_run(termui_loop_t *loop, termui_update_fn update, termui_draw_fn draw, void *user);
+
+/* Sleep until the next deadline and run whatever is due
+ * For callers that own their loop; returns false once stopped */
+bool termui_loop_step(termui_loop_t *loop, termui_update_fn update, termui_draw_fn draw, void *user);
+
+/* Draw at the next render slot even if no update has run */
+void termui_loop_request_redraw(termui_loop_t *loop);
+
+/* Stop the loop after the current callback returns */
+void termui_loop_stop(termui_loop_t *loop);
+
+/* Get update/render counters and missed deadlines */
+void termui_loop_get_stats(const termui_loop_t *loop, termui_loop_stats_t *stats);
+
 /*
  * Input Functions
  */
@@ -161,6 +771,76 @@ termui_input_t termui_input_poll(void);
  * Only valid when raw_keys config is true */
 int termui_input_raw_key(void);
 
+/* Read every pending key into events without blocking
+ * Returns the number of events stored (at most max); keys beyond max stay
+ * queued. A pending resize is reported first as TERMUI_INPUT_RESIZE.
+ * Unmapped keys are dropped unless raw_keys is set. With
+ * TERMUI_DRAIN_COALESCE, consecutive identical movement actions (held
+ * keys) become one event with a count */
+int termui_input_drain(termui_input_event_t *events, int max, int flags);
+
+/* Wait for input, blocking up to timeout_ms (-1 waits forever, 0 polls)
+ * Wakes immediately on a keypress, a resize, termui_input_wake, or a
+ * watched fd or timer, whose callbacks run inside the wait.
+ * Unmapped keys and gamepad reports that queue no action (releases,
+ * axis noise) neither end the wait nor extend it past timeout_ms.
+ * Returns TERMUI_INPUT_NONE on timeout, after callbacks ran, or when a
+ * raw_keys key arrived (see termui_input_raw_key) */
+termui_input_t termui_input_wait(int timeout_ms);
+
+/* Make a pending or the next termui_input_wait return
+ * Safe to call from signal handlers and other threads */
+void termui_input_wake(void);
+
+/* Watch fd for TERMUI_FD_READ and/or TERMUI_FD_WRITE during waits
+ * Watching an fd again replaces its events and callback */
+int termui_input_watch_fd(int fd, int events, termui_fd_fn callback, void *user);
+
+/* Stop watching fd (may be called from its callback) */
+void termui_input_unwatch_fd(int fd);
+
+/* Call callback after interval_ms, then every interval_ms if repeat
+ * Timers run inside termui_input_wait. Returns a timer id (> 0) or an
+ * error code */
+int termui_timer_add(int interval_ms, bool repeat, termui_timer_fn callback, void *user);
+
+/* Cancel a timer (may be called from its callback) */
+void termui_timer_remove(int id);
+
+/*
+ * Gamepad Input (Linux evdev)
+ *
+ * An open gamepad feeds its actions into termui_input_poll, drain and
+ * wait alongside the keyboard: d-pad or left stick directions give
+ * UP/DOWN/LEFT/RIGHT, buttons give ACTION, CANCEL and ZOOM_IN/OUT.
+ * Gamepad events carry a raw key of -1. Button n is the button code's
+ * offset from BTN_GAMEPAD or BTN_JOYSTICK.
+ */
+
+/* Open an evdev device (e.g. "/dev/input/event3"), or the first gamepad
+ * found if path is NULL. Call after termui_init. Returns NULL if none
+ * could be opened.
+ * termui_cleanup closes the devices of gamepads still open but does not
+ * free them: the handle stays valid (reporting disconnected) until
+ * termui_gamepad_close, which may be called before or after cleanup */
+termui_gamepad_t* termui_gamepad_open(const char *path);
+
+/* Read gamepad events from an open evdev fd, or from a pipe carrying
+ * struct input_event records (replays, tests: no axes, gamepad buttons).
+ * The fd is made non-blocking and closed by termui_gamepad_close.
+ * Returns NULL, leaving fd open, on failure */
+termui_gamepad_t* termui_gamepad_open_fd(int fd);
+
+/* Close a gamepad and free its handle */
+void termui_gamepad_close(termui_gamepad_t *pad);
+
+/* Set the stick deadzone as a percentage of travel (default: 15)
+ * The device's own flat zone is used if larger */
+void termui_gamepad_set_deadzone(termui_gamepad_t *pad, int percent);
+
+/* Get current stick, d-pad and button state */
+void termui_gamepad_get_state(const termui_gamepad_t *pad, termui_gamepad_state_t *state);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,908 @@
+/*
+ * termui - Direct ANSI Backend
+ *
+ * Drives the terminal without ncurses: raw tty mode via termios, frames
+ * encoded straight into one contiguous escape-sequence buffer and
+ * presented with a single write, wrapped in synchronized output mode
+ * (DEC private mode 2026) so the terminal shows the frame atomically.
+ *
+ * Output goes to a non-blocking descriptor of the tty. Bytes the terminal
+ * has not accepted yet stay queued and are pushed out as it drains;
+ * render defers new frames until the queue is empty, so a congested
+ * link drops frames instead of blocking the process in write().
+ *
+ * The encoder tracks the cursor within a frame and reaches each run by
+ * the cheapest of an absolute move, relative moves, CR/LF, or re-sending
+ * the unchanged cells in between when they are in the current pen.
+ *
+ * The headless backend shares this encoder; its output goes to the
+ * in-memory terminal model in termui_headless.c instead of a tty.
+ *
+ * SIGINT and SIGTERM restore the tty before the signal takes effect;
+ * SIGTSTP restores it for the shell and SIGCONT takes it back.
+ */
+
+/* Enable POSIX termios and ioctl declarations */
+#define _POSIX_C_SOURCE 200809L
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <ncurses.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Escape sequences */
+#define SEQ_SYNC_BEGIN   "\033[?2026h"
+#define SEQ_SYNC_END     "\033[?2026l"
+#define SEQ_ALT_SCREEN   "\033[?1049h"
+#define SEQ_MAIN_SCREEN  "\033[?1049l"
+#define SEQ_HIDE_CURSOR  "\033[?25l"
+#define SEQ_SHOW_CURSOR  "\033[?25h"
+#define SEQ_WRAP_OFF     "\033[?7l"
+#define SEQ_WRAP_ON      "\033[?7h"
+#define SEQ_CLEAR        "\033[H\033[2J"
+#define SEQ_RESET_PEN    "\033[0m"
+
+/* Written from signal handlers: CAN aborts a sequence a frame was cut
+ * off in, then everything init changed is put back */
+#define SEQ_RESTORE      "\030" SEQ_SYNC_END SEQ_RESET_PEN SEQ_WRAP_ON SEQ_SHOW_CURSOR SEQ_MAIN_SCREEN
+#define SEQ_ENTER        SEQ_ALT_SCREEN SEQ_HIDE_CURSOR SEQ_WRAP_OFF SEQ_CLEAR
+
+/* How long a partial escape sequence waits for the rest before a lone
+ * ESC is reported (ms); ESCDELAY overrides it, as for ncurses */
+#define ESC_DELAY_MS 100
+
+/* Growable output byte buffer */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    size_t sent;    /* Leading bytes already written */
+} outbuf_t;
+
+/* Backend state */
+static outbuf_t g_out;
+static int g_out_fd = STDOUT_FILENO;   /* Non-blocking tty descriptor, -1 if headless */
+static uint64_t g_bytes_written = 0;
+static uint64_t g_bytes_encoded = 0;     /* Frame bytes encoded */
+static uint64_t g_write_calls = 0;       /* write() syscalls (headless: feeds) */
+static struct termios g_saved_termios;
+static bool g_termios_saved = false;
+static struct termios g_raw_termios;          /* Mode init set, re-applied on SIGCONT */
+static volatile sig_atomic_t g_resumed = 0;   /* Screen was given back while stopped */
+static bool g_frame_sent = false;   /* Current frame has at least one run */
+static int g_pen = -1;              /* Style id of the pen, -1 if unknown */
+static termui_style_t g_pen_style;  /* Pen as the terminal shows it */
+static int g_cur_x = -1;            /* Cursor within the frame, -1 if unknown */
+static int g_cur_y = -1;
+static int g_cur_row = 0;           /* Row the cursor was left on (kept across frames) */
+static size_t g_frame_len = 0;      /* Bytes of the last frame while it is all that is queued */
+static int g_frame_row = 0;         /* g_cur_row before the last frame */
+static bool g_out_failed = false;   /* Output could not grow; frame bytes are missing */
+
+/* Signals that restore the tty, and what they did before init */
+static const int g_signals[] = { SIGINT, SIGTERM, SIGTSTP, SIGCONT };
+#define SIGNAL_COUNT (sizeof(g_signals) / sizeof(g_signals[0]))
+static struct sigaction g_old_actions[SIGNAL_COUNT];
+static bool g_handled[SIGNAL_COUNT];
+
+/* Pending input bytes */
+static unsigned char g_in[64];
+static size_t g_in_len = 0;
+static int g_esc_delay = ESC_DELAY_MS;
+static int64_t g_esc_since = -1;    /* When a partial escape sequence was first held, -1 if none */
+
+/* Monotonic clock in milliseconds */
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool out_reserve(outbuf_t *out, size_t extra) {
+    if (out->len + extra <= out->cap) {
+        return true;
+    }
+
+    size_t cap = out->cap ? out->cap : 4096;
+    while (cap < out->len + extra) {
+        cap *= 2;
+    }
+
+    char *data = realloc(out->data, cap);
+    if (!data) {
+        g_out_failed = true;  /* Whatever is being encoded is now incomplete */
+        return false;
+    }
+    out->data = data;
+    out->cap = cap;
+    return true;
+}
+
+static void out_bytes(outbuf_t *out, const char *bytes, size_t n) {
+    if (!out_reserve(out, n)) return;
+    memcpy(out->data + out->len, bytes, n);
+    out->len += n;
+}
+
+static void out_str(outbuf_t *out, const char *str) {
+    out_bytes(out, str, strlen(str));
+}
+
+static void out_uint(outbuf_t *out, unsigned int v) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+
+    if (!out_reserve(out, n)) return;
+    while (n) {
+        out->data[out->len++] = digits[--n];
+    }
+}
+
+/* Write as much of the queue as the terminal accepts without blocking */
+static void out_write(outbuf_t *out) {
+    if (g_out_fd < 0 && out->sent < out->len) {
+        size_t n = termui_headless_feed(out->data + out->sent, out->len - out->sent);
+        g_write_calls++;
+        g_bytes_written += (uint64_t)n;
+        out->sent += n;
+    }
+
+    while (g_out_fd >= 0 && out->sent < out->len) {
+        ssize_t n = write(g_out_fd, out->data + out->sent, out->len - out->sent);
+        g_write_calls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                out->sent = out->len;  /* Terminal gone - drop the output */
+            }
+            break;
+        }
+        out->sent += (size_t)n;
+        g_bytes_written += (uint64_t)n;
+    }
+
+    if (out->sent == out->len) {
+        out->len = 0;
+        out->sent = 0;
+        g_frame_len = 0;
+    }
+}
+
+/* Write the queue, waiting up to timeout_ms (-1: forever) for the
+ * terminal to accept it. Returns true if everything was written */
+static bool out_drain(outbuf_t *out, int timeout_ms) {
+    out_write(out);
+    while (out->len > 0 && g_out_fd >= 0) {
+        struct pollfd pfd = { g_out_fd, POLLOUT, 0 };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready == 0) {
+            return false;
+        }
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+        out_write(out);
+    }
+    return out->len == 0;  /* A limited headless model may still hold some */
+}
+
+/* Open a second, non-blocking description of the output tty so the
+ * shell's stdout keeps its flags; fall back to blocking stdout */
+static int open_output(void) {
+    const char *name = ttyname(STDOUT_FILENO);
+    int fd = name ? open(name, O_WRONLY | O_NOCTTY | O_NONBLOCK) : -1;
+    if (fd < 0) {
+        return STDOUT_FILENO;
+    }
+
+    int flags = fcntl(fd, F_GETFD);
+    if (flags >= 0) {
+        fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+    return fd;
+}
+
+/* Async-signal-safe write of a whole sequence to the shell's stdout */
+static void write_all(const char *bytes, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, bytes, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        bytes += n;
+        len -= (size_t)n;
+    }
+}
+
+static void handle_signal(int sig) {
+    int saved_errno = errno;
+
+    if (sig == SIGCONT) {
+        /* Back in the foreground: take the tty again, and report a resize
+         * so the screen is cleared and repainted in full */
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_raw_termios);
+        write_all(SEQ_ENTER, sizeof(SEQ_ENTER) - 1);
+        g_resumed = 1;
+        termui_resize_notify();
+        errno = saved_errno;
+        return;
+    }
+
+    write_all(SEQ_RESTORE, sizeof(SEQ_RESTORE) - 1);
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_saved_termios);
+
+    size_t i = 0;
+    while (i < SIGNAL_COUNT && g_signals[i] != sig) {
+        i++;
+    }
+    if (i == SIGNAL_COUNT) {
+        errno = saved_errno;
+        return;
+    }
+
+    /* Re-raise under the disposition from before init; it is blocked in
+     * here, so it is delivered as soon as it is unblocked */
+    struct sigaction ours;
+    sigaction(sig, &g_old_actions[i], &ours);
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, sig);
+    raise(sig);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+
+    /* Only reached when the signal did not end the process: stopped and
+     * continued (SIGTSTP), or handled by the application */
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    sigaction(sig, &ours, NULL);
+    errno = saved_errno;
+}
+
+static void install_signal_handlers(void) {
+    struct sigaction sa;
+    sa.sa_handler = handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+
+    for (size_t i = 0; i < SIGNAL_COUNT; i++) {
+        g_handled[i] = false;
+        if (sigaction(g_signals[i], NULL, &g_old_actions[i]) != 0 ||
+            g_old_actions[i].sa_handler == SIG_IGN) {
+            continue;  /* Ignored (e.g. a background job): leave it so */
+        }
+        g_handled[i] = sigaction(g_signals[i], &sa, NULL) == 0;
+    }
+}
+
+static void restore_signal_handlers(void) {
+    for (size_t i = 0; i < SIGNAL_COUNT; i++) {
+        if (g_handled[i]) {
+            sigaction(g_signals[i], &g_old_actions[i], NULL);
+            g_handled[i] = false;
+        }
+    }
+}
+
+int termui_ansi_init(bool headless) {
+    g_out.len = 0;
+    g_out.sent = 0;
+    g_in_len = 0;
+    g_esc_since = -1;
+    g_pen = -1;
+    g_cur_row = 0;
+
+    g_esc_delay = ESC_DELAY_MS;
+    const char *delay = getenv("ESCDELAY");
+    if (delay) {
+        char *end;
+        long ms = strtol(delay, &end, 10);
+        if (end != delay && *end == '\0' && ms >= 0 && ms <= 10000) {
+            g_esc_delay = (int)ms;
+        }
+    }
+
+    if (headless) {
+        g_out_fd = -1;
+        out_str(&g_out, SEQ_ENTER);
+        out_write(&g_out);
+        return TERMUI_OK;
+    }
+
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+        return TERMUI_ERROR;
+    }
+
+    if (tcgetattr(STDIN_FILENO, &g_saved_termios) != 0) {
+        return TERMUI_ERROR;
+    }
+    g_termios_saved = true;
+
+    /* cbreak + noecho, non-blocking reads; signals stay enabled */
+    struct termios raw = g_saved_termios;
+    raw.c_iflag &= ~(tcflag_t)(ICRNL | IXON);
+    raw.c_lflag &= ~(tcflag_t)(ECHO | ICANON | IEXTEN);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != 0) {
+        g_termios_saved = false;
+        return TERMUI_ERROR;
+    }
+
+    g_raw_termios = raw;
+    g_resumed = 0;
+
+    g_out_fd = open_output();
+    out_str(&g_out, SEQ_ENTER);
+    out_drain(&g_out, -1);
+    install_signal_handlers();
+    return TERMUI_OK;
+}
+
+void termui_ansi_cleanup(void) {
+    restore_signal_handlers();
+
+    /* Finish any partial frame so its escape sequences are not cut off */
+    out_str(&g_out, SEQ_RESET_PEN SEQ_WRAP_ON SEQ_SHOW_CURSOR SEQ_MAIN_SCREEN);
+    out_drain(&g_out, -1);
+    if (g_out_fd >= 0 && g_out_fd != STDOUT_FILENO) {
+        close(g_out_fd);
+    }
+    g_out_fd = STDOUT_FILENO;
+
+    if (g_termios_saved) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_saved_termios);
+        g_termios_saved = false;
+    }
+
+    free(g_out.data);
+    g_out.data = NULL;
+    g_out.cap = 0;
+    g_out.len = 0;
+    g_out.sent = 0;
+    g_frame_len = 0;
+}
+
+void termui_ansi_get_size(int *width, int *height) {
+    struct winsize ws;
+    int w = 80;
+    int h = 24;
+
+    if (g_out_fd < 0) {
+        termui_headless_get_size(width, height);
+        return;
+    }
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        w = ws.ws_col;
+        h = ws.ws_row;
+    }
+    if (width) *width = w;
+    if (height) *height = h;
+}
+
+void termui_ansi_clear(void) {
+    /* Queued after any partial frame, which must still complete */
+    out_str(&g_out, SEQ_RESET_PEN SEQ_CLEAR);
+    out_write(&g_out);
+    g_pen = -1;
+    g_cur_row = 0;
+}
+
+bool termui_ansi_resize_keeps(int height) {
+    /* Terminals keep the cells of a resized screen in place unless it
+     * shrinks past the cursor, which is kept on screen by scrolling the
+     * content up. A frame still being written is cut off either way */
+    if (g_resumed) {
+        g_resumed = 0;  /* Stopped meanwhile: the screen was handed back */
+        return false;
+    }
+    return termui_ansi_pending() == 0 && g_cur_row < height;
+}
+
+size_t termui_ansi_pending(void) {
+    if (g_out.len > 0) {
+        out_write(&g_out);
+    }
+    return g_out.len - g_out.sent;
+}
+
+int termui_ansi_out_fd(void) {
+    return g_out_fd;
+}
+
+uint64_t termui_ansi_bytes_written(void) {
+    return g_bytes_written;
+}
+
+uint64_t termui_ansi_bytes_encoded(void) {
+    return g_bytes_encoded;
+}
+
+uint64_t termui_ansi_write_calls(void) {
+    return g_write_calls;
+}
+
+size_t termui_ansi_tty_queue(void) {
+#ifdef TIOCOUTQ
+    int n = 0;
+    if (ioctl(g_out_fd, TIOCOUTQ, &n) == 0 && n > 0) {
+        return (size_t)n;
+    }
+#endif
+    return 0;
+}
+
+int termui_ansi_push_input(const char *bytes, size_t len) {
+    if (len > sizeof(g_in) - g_in_len) {
+        return TERMUI_ERROR;  /* Not read yet - the app is behind */
+    }
+    memcpy(g_in + g_in_len, bytes, len);
+    g_in_len += len;
+    return TERMUI_OK;
+}
+
+bool termui_ansi_has_input(void) {
+    return g_in_len > 0;
+}
+
+int termui_ansi_input_delay(void) {
+    if (g_esc_since < 0) {
+        return -1;
+    }
+    int64_t left = g_esc_since + g_esc_delay - now_ms();
+    return left > 0 ? (int)left : 0;
+}
+
+/* Top up the pending input bytes from stdin */
+static void fill_input(void) {
+    if (g_out_fd < 0) {
+        return;  /* Headless: input only comes from termui_ansi_push_input */
+    }
+    while (g_in_len < sizeof(g_in)) {
+        ssize_t n = read(STDIN_FILENO, g_in + g_in_len, sizeof(g_in) - g_in_len);
+        if (n > 0) {
+            g_in_len += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+}
+
+static void consume_input(size_t n) {
+    memmove(g_in, g_in + n, g_in_len - n);
+    g_in_len -= n;
+}
+
+int termui_ansi_getch(void) {
+    for (;;) {
+        fill_input();
+        if (g_in_len == 0) {
+            return ERR;
+        }
+
+        int ch = g_in[0];
+        if (ch != 27) {
+            consume_input(1);
+            return ch == '\r' ? '\n' : ch;
+        }
+
+        /* SS3 (ESC O x) and CSI (ESC [ params final) sequences */
+        bool sequence = g_in_len > 1 && (g_in[1] == 'O' || g_in[1] == '[');
+        size_t end = 2;
+        if (g_in_len > 1 && g_in[1] == '[') {
+            while (end < g_in_len && (g_in[end] < 0x40 || g_in[end] > 0x7e)) {
+                end++;
+            }
+        }
+
+        /* The rest of a sequence may still be on its way (a slow link
+         * splits it across reads): hold it, and only report a lone ESC
+         * once nothing completed it within the delay */
+        if (g_in_len == 1 || (sequence && end >= g_in_len)) {
+            if (g_in_len == sizeof(g_in)) {
+                consume_input(g_in_len);  /* Overlong garbage, never completes */
+                g_esc_since = -1;
+                return ERR;
+            }
+            int64_t now = now_ms();
+            if (g_esc_since < 0) {
+                g_esc_since = now;
+            }
+            if (now - g_esc_since < g_esc_delay) {
+                return ERR;
+            }
+            g_esc_since = -1;
+            consume_input(1);
+            return 27;
+        }
+        g_esc_since = -1;
+
+        if (sequence) {
+            unsigned char final = g_in[end];
+            consume_input(end + 1);
+            switch (final) {
+                case 'A': return KEY_UP;
+                case 'B': return KEY_DOWN;
+                case 'C': return KEY_RIGHT;
+                case 'D': return KEY_LEFT;
+                case 'H': return KEY_HOME;
+                case 'F': return KEY_END;
+                case 'M': return KEY_ENTER;
+                default:  continue;  /* Unsupported key - skip */
+            }
+        }
+
+        /* ESC followed by a plain key (Alt+key) - report the ESC */
+        consume_input(1);
+        return 27;
+    }
+}
+
+void termui_ansi_frame_begin(void) {
+    /* Only called with nothing pending (render defers otherwise) */
+    g_out.len = 0;
+    g_out.sent = 0;
+    g_frame_sent = false;
+    g_frame_row = g_cur_row;
+    g_out_failed = false;
+    g_cur_x = g_cur_y = -1;
+    out_str(&g_out, SEQ_SYNC_BEGIN);
+}
+
+/* Append one SGR parameter, opening the sequence on the first */
+static void sgr_param(bool *open, unsigned int v) {
+    if (*open) {
+        out_bytes(&g_out, ";", 1);
+    } else {
+        out_str(&g_out, "\033[");
+    }
+    out_uint(&g_out, v);
+    *open = true;
+}
+
+/* Foreground (base 30) or background (base 40) color parameters */
+static void sgr_color(bool *open, termui_xcolor_t color, unsigned int base) {
+    unsigned int kind = color >> 24;
+    unsigned int n = color & 0xffu;
+
+    if (kind == 0) {
+        sgr_param(open, base + 9);
+    } else if (kind == 1 && n < 8) {
+        sgr_param(open, base + n);
+    } else if (kind == 1 && n < 16) {
+        sgr_param(open, base + 60 + n - 8);
+    } else if (kind == 1) {
+        sgr_param(open, base + 8);
+        sgr_param(open, 5);
+        sgr_param(open, n);
+    } else {
+        sgr_param(open, base + 8);
+        sgr_param(open, 2);
+        sgr_param(open, (color >> 16) & 0xffu);
+        sgr_param(open, (color >> 8) & 0xffu);
+        sgr_param(open, n);
+    }
+}
+
+/* Switch the pen to a style, sending only the parameters that differ */
+static void pen_set(unsigned int id, bool colors) {
+    const termui_style_t *style = termui_style_get(id);
+    termui_color_mode_t mode = termui_get_color_mode();
+    termui_style_t want = {
+        colors ? termui_xcolor_reduce(style->fg, mode) : TERMUI_XCOLOR_DEFAULT,
+        colors ? termui_xcolor_reduce(style->bg, mode) : TERMUI_XCOLOR_DEFAULT,
+        style->attrs
+    };
+
+    bool open = false;
+    if (g_pen < 0) {
+        sgr_param(&open, 0);
+        memset(&g_pen_style, 0, sizeof(g_pen_style));
+    }
+
+    unsigned int off = g_pen_style.attrs & ~want.attrs;
+    unsigned int on = want.attrs & ~g_pen_style.attrs;
+    if (off & TERMUI_ATTR_BOLD) sgr_param(&open, 22);
+    if (off & TERMUI_ATTR_UNDERLINE) sgr_param(&open, 24);
+    if (off & TERMUI_ATTR_REVERSE) sgr_param(&open, 27);
+    if (on & TERMUI_ATTR_BOLD) sgr_param(&open, 1);
+    if (on & TERMUI_ATTR_UNDERLINE) sgr_param(&open, 4);
+    if (on & TERMUI_ATTR_REVERSE) sgr_param(&open, 7);
+    if (want.fg != g_pen_style.fg) sgr_color(&open, want.fg, 30);
+    if (want.bg != g_pen_style.bg) sgr_color(&open, want.bg, 40);
+
+    if (open) {
+        out_bytes(&g_out, "m", 1);
+    }
+    g_pen_style = want;
+    g_pen = (int)id;
+}
+
+static size_t digits(unsigned int v) {
+    size_t n = 1;
+    while (v >= 10) {
+        v /= 10;
+        n++;
+    }
+    return n;
+}
+
+/* Bytes of a relative move "ESC [ n final" (n omitted when 1) */
+static size_t rel_cost(int n) {
+    return 3 + (n > 1 ? digits((unsigned int)n) : 0);
+}
+
+static void rel_move(int n, char final) {
+    out_str(&g_out, "\033[");
+    if (n > 1) {
+        out_uint(&g_out, (unsigned int)n);
+    }
+    out_bytes(&g_out, &final, 1);
+}
+
+/* Send the glyph of cells[x]; x0 is the first column of the run */
+static void put_glyph(const termui_cell_t *cells, int x, int x0) {
+    unsigned int glyph = termui_cell_glyph(cells[x]);
+    if (glyph < TERMUI_GLYPH_FIRST) {
+        char ch = glyph < 0x20 || glyph == 0x7f ? '?' : (char)glyph;
+        out_bytes(&g_out, &ch, 1);
+    } else if (glyph != TERMUI_GLYPH_CONT) {
+        size_t len;
+        const char *bytes = termui_glyph_bytes(glyph, &len);
+        out_bytes(&g_out, bytes, len);
+    } else if (x == x0) {
+        /* Orphaned right half at the start of a run */
+        out_bytes(&g_out, " ", 1);
+    }
+}
+
+/* Bytes needed to re-send the unchanged cells [x0, x1) to step over
+ * them, or SIZE_MAX if that is not possible without a pen change or costs
+ * more than limit */
+static size_t gap_cost(const termui_cell_t *cells, int x0, int x1, size_t limit) {
+    if (g_pen < 0 || termui_cell_glyph(cells[x0]) == TERMUI_GLYPH_CONT) {
+        return SIZE_MAX;
+    }
+
+    size_t cost = 0;
+    for (int x = x0; x < x1 && cost <= limit; x++) {
+        if ((int)termui_cell_style(cells[x]) != g_pen) {
+            return SIZE_MAX;
+        }
+        unsigned int glyph = termui_cell_glyph(cells[x]);
+        if (glyph < TERMUI_GLYPH_FIRST) {
+            cost++;
+        } else if (glyph != TERMUI_GLYPH_CONT) {
+            size_t len;
+            termui_glyph_bytes(glyph, &len);
+            cost += len;
+        }
+    }
+    return cost <= limit ? cost : SIZE_MAX;
+}
+
+/* Ways to reach a column on the cursor's row */
+typedef enum {
+    HMOVE_NONE,
+    HMOVE_FORWARD,      /* CUF */
+    HMOVE_BACK,         /* CUB */
+    HMOVE_GAP           /* Re-send the cells in between */
+} hmove_t;
+
+/* Cheapest way from column c to column x on a row; returns its bytes */
+static size_t plan_column(const termui_cell_t *cells, int c, int x, hmove_t *how) {
+    if (x == c) {
+        *how = HMOVE_NONE;
+        return 0;
+    }
+    if (x < c) {
+        *how = HMOVE_BACK;
+        return rel_cost(c - x);
+    }
+
+    size_t cost = rel_cost(x - c);
+    size_t gap = gap_cost(cells, c, x, cost - 1);
+    *how = gap < cost ? HMOVE_GAP : HMOVE_FORWARD;
+    return gap < cost ? gap : cost;
+}
+
+static void do_column(const termui_cell_t *cells, int c, int x, hmove_t how) {
+    switch (how) {
+        case HMOVE_FORWARD:
+            rel_move(x - c, 'C');
+            break;
+        case HMOVE_BACK:
+            rel_move(c - x, 'D');
+            break;
+        case HMOVE_GAP:
+            for (int i = c; i < x; i++) {
+                put_glyph(cells, i, c);
+            }
+            break;
+        case HMOVE_NONE:
+            break;
+    }
+}
+
+/* Ways to reach another row (or column 0 of this one) */
+typedef enum {
+    VMOVE_NONE,
+    VMOVE_UP,           /* CUU */
+    VMOVE_DOWN,         /* CUD */
+    VMOVE_NEWLINE       /* CR, then LF per row: lands in column 0 */
+} vmove_t;
+
+/* Move the cursor to (x, y) of the row cells as cheaply as possible */
+static void move_to(const termui_cell_t *cells, int x, int y) {
+    if (g_cur_x == x && g_cur_y == y) {
+        return;
+    }
+
+    /* Absolute CUP: "ESC [ row H", or "ESC [ row ; col H" */
+    size_t best = 3 + digits((unsigned int)y + 1) + (x > 0 ? 1 + digits((unsigned int)x + 1) : 0);
+    bool absolute = true;
+    vmove_t vbest = VMOVE_NONE;
+    hmove_t hbest = HMOVE_NONE;
+
+    if (g_cur_y >= 0) {
+        int dy = y - g_cur_y;
+        vmove_t options[2] = { VMOVE_NONE, VMOVE_NEWLINE };
+        options[0] = dy > 0 ? VMOVE_DOWN : dy < 0 ? VMOVE_UP : VMOVE_NONE;
+        int count = dy >= 0 ? 2 : 1;  /* LF only moves down */
+
+        for (int i = 0; i < count; i++) {
+            size_t cost;
+            int col = g_cur_x;
+            if (options[i] == VMOVE_NEWLINE) {
+                cost = 1 + (size_t)dy;
+                col = 0;
+            } else {
+                cost = options[i] == VMOVE_NONE ? 0 : rel_cost(dy > 0 ? dy : -dy);
+            }
+
+            hmove_t how;
+            cost += plan_column(cells, col, x, &how);
+            if (cost < best) {
+                best = cost;
+                absolute = false;
+                vbest = options[i];
+                hbest = how;
+            }
+        }
+    }
+
+    if (absolute) {
+        out_str(&g_out, "\033[");
+        out_uint(&g_out, (unsigned int)y + 1);
+        if (x > 0) {
+            out_bytes(&g_out, ";", 1);
+            out_uint(&g_out, (unsigned int)x + 1);
+        }
+        out_bytes(&g_out, "H", 1);
+    } else {
+        int col = g_cur_x;
+        switch (vbest) {
+            case VMOVE_UP:
+                rel_move(g_cur_y - y, 'A');
+                break;
+            case VMOVE_DOWN:
+                rel_move(y - g_cur_y, 'B');
+                break;
+            case VMOVE_NEWLINE:
+                out_bytes(&g_out, "\r", 1);
+                for (int i = g_cur_y; i < y; i++) {
+                    out_bytes(&g_out, "\n", 1);
+                }
+                col = 0;
+                break;
+            case VMOVE_NONE:
+                break;
+        }
+        do_column(cells, col, x, hbest);
+    }
+
+    g_cur_x = x;
+    g_cur_y = y;
+    g_cur_row = y;
+}
+
+void termui_ansi_frame_run(const termui_buffer_t *buf, int y, int x0, int x1) {
+    bool colors = termui_colors_active();
+    const termui_cell_t *cells = buf->cells + (size_t)y * (size_t)buf->width;
+
+    if (g_out_failed || !out_reserve(&g_out, (size_t)(x1 - x0) * 8 + 16)) return;
+
+    move_to(cells, x0, y);
+
+    for (int x = x0; x < x1; x++) {
+        unsigned int style = termui_cell_style(cells[x]);
+        if ((int)style != g_pen) {
+            pen_set(style, colors);
+        }
+        put_glyph(cells, x, x0);
+    }
+
+    /* With autowrap off the cursor sticks at the last column */
+    g_cur_x = x1 < buf->width ? x1 : -1;
+    g_cur_y = x1 < buf->width ? y : -1;
+    g_frame_sent = true;
+}
+
+void termui_ansi_frame_scroll(int top, int bottom, int n) {
+    if (g_out_failed) return;
+
+    /* Scrolled-in lines take the current background */
+    if (g_pen < 0 || g_pen_style.bg != TERMUI_XCOLOR_DEFAULT || (g_pen_style.attrs & TERMUI_ATTR_REVERSE)) {
+        out_str(&g_out, SEQ_RESET_PEN);
+        memset(&g_pen_style, 0, sizeof(g_pen_style));
+        g_pen = 0;
+    }
+
+    /* DECSTBM, then SU or SD, then reset the margins */
+    out_str(&g_out, "\033[");
+    out_uint(&g_out, (unsigned int)top + 1);
+    out_bytes(&g_out, ";", 1);
+    out_uint(&g_out, (unsigned int)bottom + 1);
+    out_str(&g_out, "r\033[");
+    out_uint(&g_out, (unsigned int)(n > 0 ? n : -n));
+    out_bytes(&g_out, n > 0 ? "S" : "T", 1);
+    out_str(&g_out, "\033[r");
+
+    /* Setting the margins homes the cursor */
+    g_cur_x = g_cur_y = 0;
+    g_cur_row = 0;
+    g_frame_sent = true;
+}
+
+bool termui_ansi_frame_end(void) {
+    if (!g_frame_sent) {
+        g_out.len = 0;
+        return !g_out_failed;
+    }
+
+    out_str(&g_out, SEQ_SYNC_END);
+    if (g_out_failed) {
+        /* Never send a frame with bytes missing: a cut escape sequence
+         * would corrupt the terminal. Nothing of it is out yet */
+        g_out.len = 0;
+        g_out_failed = false;
+        g_pen = -1;
+        g_cur_row = g_frame_row;
+        return false;
+    }
+
+    g_bytes_encoded += g_out.len;
+    g_frame_len = g_out.len;
+    out_write(&g_out);
+    return true;
+}
+
+bool termui_ansi_frame_drop(void) {
+    /* Once any byte is out the frame must complete: the terminal is
+     * inside synchronized output and possibly an escape sequence */
+    if (g_frame_len == 0 || g_out.sent != 0 || g_out.len != g_frame_len) {
+        return false;
+    }
+
+    g_out.len = 0;
+    g_frame_len = 0;
+    g_pen = -1;
+    g_cur_row = g_frame_row;
+    return true;
+}
@@ -2,20 +2,96 @@
  * termui - Frame Buffer Implementation
  *
  * Double-buffered rendering for flicker-free terminal output.
+ *
+ * Each buffer keeps a copy of the frame it last presented plus a
+ * per-row dirty span. Drawing widens the span of the rows it touches
+ * so that rendering (termui_render.c) only has to compare those spans.
+ *
+ * A view is a buffer whose cells are a rectangle of another buffer's
+ * (rows stride apart) with a damage map of its own and no presented
+ * copy; tiles (termui_tile.c) are views. Drawing never touches cells
+ * outside a buffer, so views of disjoint rectangles can be drawn from
+ * different threads.
  */
 
 #include "termui.h"
-#include <ncurses.h>
+#include "termui_internal.h"
 #include <stdlib.h>
 #include <string.h>
 
-/* Frame buffer structure */
-struct termui_buffer {
-    int width;
-    int height;
-    char *chars;           /* Character data */
-    termui_color_t *colors; /* Per-cell color */
-};
+/* Cells of row y (tiles address rows of their parent) */
+static termui_cell_t* row_cells(termui_buffer_t *buf, int y) {
+    return buf->cells + (size_t)y * (size_t)buf->stride;
+}
+
+/* Widen the dirty span of row y to include columns [x0, x1) */
+static void mark_dirty(termui_buffer_t *buf, int y, int x0, int x1) {
+    struct termui_front *f = buf->front;
+    if (x0 < f->dirty_lo[y]) f->dirty_lo[y] = x0;
+    if (x1 > f->dirty_hi[y]) f->dirty_hi[y] = x1;
+    f->dirty = true;
+}
+
+void termui_buffer_mark_dirty(termui_buffer_t *buf, int y, int x0, int x1) {
+    mark_dirty(buf, y, x0, x1);
+}
+
+/* Mark every row fully dirty */
+static void mark_all_dirty(termui_buffer_t *buf) {
+    struct termui_front *f = buf->front;
+    for (int y = 0; y < buf->height; y++) {
+        f->dirty_lo[y] = 0;
+        f->dirty_hi[y] = buf->width;
+    }
+    f->dirty = true;
+}
+
+/* True when render will repaint everything regardless of content */
+static bool front_stale(const termui_buffer_t *buf) {
+    return !buf->front->valid || buf->front->epoch != termui_screen_epoch();
+}
+
+void termui_buffer_clear_dirty(const termui_buffer_t *buf) {
+    struct termui_front *f = buf->front;
+    for (int y = 0; y < buf->height; y++) {
+        f->dirty_lo[y] = buf->width;
+        f->dirty_hi[y] = 0;
+    }
+    f->dirty = false;
+}
+
+static void front_destroy(struct termui_front *f) {
+    if (f) {
+        free(f->cells);
+        free(f->dirty_lo);
+        free(f->dirty_hi);
+        free(f->row_hash);
+        free(f->row_state);
+        free(f);
+    }
+}
+
+static struct termui_front* front_create(int width, int height) {
+    struct termui_front *f = calloc(1, sizeof(struct termui_front));
+    if (!f) {
+        return NULL;
+    }
+
+    size_t size = (size_t)width * (size_t)height;
+    f->cells = malloc(size * sizeof(termui_cell_t));
+    f->dirty_lo = malloc((size_t)height * sizeof(int));
+    f->dirty_hi = malloc((size_t)height * sizeof(int));
+    f->row_hash = malloc((size_t)height * 2 * sizeof(uint64_t));
+    f->row_state = malloc((size_t)height);
+    if (!f->cells || !f->dirty_lo || !f->dirty_hi || !f->row_hash || !f->row_state) {
+        front_destroy(f);
+        return NULL;
+    }
+
+    f->rows = height;
+    f->valid = false;
+    return f;
+}
 
 termui_buffer_t* termui_buffer_create(int width, int height) {
     if (width <= 0 || height <= 0) {
@@ -29,18 +105,21 @@ termui_buffer_t* termui_buffer_create(int width, int height) {
 
     buf->width = width;
     buf->height = height;
+    buf->stride = width;
+    buf->view = false;
 
     size_t size = (size_t)width * (size_t)height;
+    buf->capacity = size;
 
-    buf->chars = malloc(size);
-    if (!buf->chars) {
+    buf->cells = malloc(size * sizeof(termui_cell_t));
+    if (!buf->cells) {
         free(buf);
         return NULL;
     }
 
-    buf->colors = malloc(size * sizeof(termui_color_t));
-    if (!buf->colors) {
-        free(buf->chars);
+    buf->front = front_create(width, height);
+    if (!buf->front) {
+        free(buf->cells);
         free(buf);
         return NULL;
     }
@@ -49,20 +128,292 @@ termui_buffer_t* termui_buffer_create(int width, int height) {
     return buf;
 }
 
+termui_buffer_t* termui_buffer_view_create(termui_buffer_t *parent, int x, int y, int width, int height) {
+    termui_buffer_t *view = calloc(1, sizeof(termui_buffer_t));
+    struct termui_front *f = calloc(1, sizeof(struct termui_front));
+    if (!view || !f) {
+        free(view);
+        free(f);
+        return NULL;
+    }
+
+    view->view = true;
+    view->front = f;
+    if (!termui_buffer_view_place(view, parent, x, y, width, height)) {
+        termui_buffer_view_destroy(view);
+        return NULL;
+    }
+    return view;
+}
+
+bool termui_buffer_view_place(termui_buffer_t *view, termui_buffer_t *parent, int x, int y, int width, int height) {
+    struct termui_front *f = view->front;
+    if (height > f->rows || !f->dirty_lo) {
+        int rows = height > 0 ? height : 1;
+        int *spans = malloc((size_t)rows * 2 * sizeof(int));
+        if (!spans) {
+            return false;
+        }
+        free(f->dirty_lo);
+        f->dirty_lo = spans;
+        f->rows = rows;
+    }
+
+    f->dirty_hi = f->dirty_lo + f->rows;
+    view->width = width;
+    view->height = height;
+    view->stride = parent->stride;
+    view->cells = parent->cells + (size_t)y * (size_t)parent->stride + (size_t)x;
+    termui_buffer_clear_dirty(view);
+    return true;
+}
+
+void termui_buffer_view_commit(termui_buffer_t *view, termui_buffer_t *parent, int x, int y) {
+    struct termui_front *f = view->front;
+    if (!f->dirty) return;
+
+    for (int row = 0; row < view->height; row++) {
+        if (f->dirty_lo[row] < f->dirty_hi[row]) {
+            mark_dirty(parent, y + row, x + f->dirty_lo[row], x + f->dirty_hi[row]);
+        }
+    }
+    termui_buffer_clear_dirty(view);
+}
+
+void termui_buffer_view_destroy(termui_buffer_t *view) {
+    if (view) {
+        free(view->front->dirty_lo);
+        free(view->front);
+        free(view);
+    }
+}
+
 void termui_buffer_destroy(termui_buffer_t *buf) {
-    if (buf) {
-        free(buf->chars);
-        free(buf->colors);
+    if (buf && !buf->view) {
+        termui_render_forget(buf);
+        free(buf->cells);
+        front_destroy(buf->front);
         free(buf);
     }
 }
 
+/* Reallocate the cell copies, then the per-row arrays, to hold at least
+ * size cells and rows rows. Capacity doubles, so dragging a window edge
+ * reallocates a handful of times rather than once per step */
+static bool reserve(termui_buffer_t *buf, size_t size, int rows) {
+    struct termui_front *f = buf->front;
+
+    if (size > buf->capacity) {
+        size_t capacity = buf->capacity * 2 > size ? buf->capacity * 2 : size;
+        termui_cell_t *cells = realloc(buf->cells, capacity * sizeof(termui_cell_t));
+        if (!cells) return false;
+        buf->cells = cells;
+        cells = realloc(f->cells, capacity * sizeof(termui_cell_t));
+        if (!cells) return false;
+        f->cells = cells;
+        buf->capacity = capacity;
+    }
+
+    if (rows > f->rows) {
+        size_t n = (size_t)(f->rows * 2 > rows ? f->rows * 2 : rows);
+        int *lo = realloc(f->dirty_lo, n * sizeof(int));
+        if (!lo) return false;
+        f->dirty_lo = lo;
+        int *hi = realloc(f->dirty_hi, n * sizeof(int));
+        if (!hi) return false;
+        f->dirty_hi = hi;
+        uint64_t *hash = realloc(f->row_hash, n * 2 * sizeof(uint64_t));
+        if (!hash) return false;
+        f->row_hash = hash;
+        unsigned char *state = realloc(f->row_state, n);
+        if (!state) return false;
+        f->row_state = state;
+        f->rows = (int)n;
+    }
+    return true;
+}
+
+/* Re-lay out a width x height grid of cells (rows packed) as new_width x
+ * new_height in place, keeping the top-left corner; new cells get fill */
+static void relayout(termui_cell_t *cells, int width, int height, int new_width, int new_height,
+                     termui_cell_t fill) {
+    int keep_w = width < new_width ? width : new_width;
+    int keep_h = height < new_height ? height : new_height;
+
+    if (new_width <= width) {
+        for (int y = 1; y < keep_h; y++) {
+            memmove(cells + (size_t)y * (size_t)new_width, cells + (size_t)y * (size_t)width,
+                    (size_t)keep_w * sizeof(termui_cell_t));
+        }
+    } else {
+        /* Rows move towards the end: go backwards so none is overwritten */
+        for (int y = keep_h - 1; y >= 0; y--) {
+            termui_cell_t *row = cells + (size_t)y * (size_t)new_width;
+            memmove(row, cells + (size_t)y * (size_t)width, (size_t)keep_w * sizeof(termui_cell_t));
+            termui_cells_fill(row + keep_w, fill, (size_t)(new_width - keep_w));
+        }
+    }
+
+    if (new_height > keep_h) {
+        termui_cells_fill(cells + (size_t)keep_h * (size_t)new_width, fill,
+                          (size_t)(new_height - keep_h) * (size_t)new_width);
+    }
+}
+
+int termui_buffer_resize(termui_buffer_t *buf, int width, int height) {
+    if (!buf || buf->view || width <= 0 || height <= 0) {
+        return TERMUI_INVALID;
+    }
+    if (width == buf->width && height == buf->height) {
+        return TERMUI_OK;
+    }
+
+    struct termui_front *f = buf->front;
+    termui_tiles_collect(buf);
+    if (!reserve(buf, (size_t)width * (size_t)height, height)) {
+        return TERMUI_NOMEM;
+    }
+
+    int old_width = buf->width;
+    int old_height = buf->height;
+    relayout(buf->cells, old_width, old_height, width, height, TERMUI_CELL_BLANK);
+    relayout(f->cells, old_width, old_height, width, height, TERMUI_CELL_UNKNOWN);
+    buf->width = width;
+    buf->height = height;
+    buf->stride = width;
+
+    /* Damage: clip the kept rows, add what was uncovered */
+    for (int y = 0; y < height; y++) {
+        if (y >= old_height) {
+            f->dirty_lo[y] = 0;
+            f->dirty_hi[y] = width;
+            continue;
+        }
+        if (f->dirty_lo[y] > width) f->dirty_lo[y] = width;
+        if (f->dirty_hi[y] > width) f->dirty_hi[y] = width;
+        if (width > old_width) {
+            mark_dirty(buf, y, old_width, width);
+        }
+    }
+    if (height > old_height) {
+        f->dirty = true;
+    }
+
+    /* A wide glyph cut by the new right edge: blank the half left over,
+     * and resend that cell, as the terminal's copy was cut too */
+    if (width < old_width) {
+        for (int y = 0; y < height && y < old_height; y++) {
+            termui_cell_t *row = row_cells(buf, y);
+            if (termui_glyph_width(termui_cell_glyph(row[width - 1])) == 2) {
+                row[width - 1] = (row[width - 1] & ~(termui_cell_t)TERMUI_CELL_GLYPH_MASK) | ' ';
+                f->cells[(size_t)y * (size_t)width + (size_t)width - 1] = TERMUI_CELL_UNKNOWN;
+                mark_dirty(buf, y, width - 1, width);
+            }
+        }
+    }
+
+    if (f->tiles && !termui_tiles_layout(buf)) {
+        return TERMUI_NOMEM;
+    }
+    return TERMUI_OK;
+}
+
 void termui_buffer_clear(termui_buffer_t *buf) {
     if (!buf) return;
 
-    size_t size = (size_t)buf->width * (size_t)buf->height;
-    memset(buf->chars, ' ', size);
-    memset(buf->colors, TERMUI_COLOR_DEFAULT, size * sizeof(termui_color_t));
+    if (buf->view) {
+        for (int y = 0; y < buf->height; y++) {
+            termui_cells_fill(row_cells(buf, y), TERMUI_CELL_BLANK, (size_t)buf->width);
+        }
+    } else {
+        size_t size = (size_t)buf->width * (size_t)buf->height;
+        termui_cells_fill(buf->cells, TERMUI_CELL_BLANK, size);
+    }
+    mark_all_dirty(buf);
+}
+
+void termui_buffer_invalidate(termui_buffer_t *buf) {
+    if (!buf) return;
+
+    if (!buf->view) {
+        buf->front->valid = false;
+    }
+    mark_all_dirty(buf);
+}
+
+bool termui_buffer_is_dirty(const termui_buffer_t *buf) {
+    if (!buf) return false;
+    if (buf->view) {
+        return buf->front->dirty;  /* Tile: drawn into since collected */
+    }
+
+    termui_tiles_collect(buf);
+    return buf->front->dirty || front_stale(buf);
+}
+
+int termui_buffer_diff_rows(const termui_buffer_t *buf, int *first, int *last) {
+    if (!buf || !first || !last || buf->view) return 0;
+
+    termui_tiles_collect(buf);
+    const struct termui_front *f = buf->front;
+    bool stale = front_stale(buf);
+    int changed = 0;
+
+    for (int y = 0; y < buf->height; y++) {
+        first[y] = -1;
+        last[y] = -1;
+
+        if (stale) {
+            first[y] = 0;
+            last[y] = buf->width - 1;
+            changed++;
+            continue;
+        }
+
+        /* Cells outside the dirty span still match the presented frame */
+        int lo = f->dirty_lo[y];
+        int hi = f->dirty_hi[y];
+        if (lo >= hi) continue;
+
+        size_t row = (size_t)y * (size_t)buf->width + (size_t)lo;
+        size_t a, b;
+        if (termui_cells_diff(buf->cells + row, f->cells + row, (size_t)(hi - lo), &a, &b)) {
+            first[y] = lo + (int)a;
+            last[y] = lo + (int)b;
+            changed++;
+        }
+    }
+
+    return changed;
+}
+
+bool termui_buffer_region_changed(const termui_buffer_t *buf, int x, int y, int width, int height) {
+    if (!buf || buf->view) return false;
+
+    /* Clip to the buffer */
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + width > buf->width ? buf->width : x + width;
+    int y1 = y + height > buf->height ? buf->height : y + height;
+    if (x0 >= x1 || y0 >= y1) return false;
+
+    if (front_stale(buf)) return true;
+
+    termui_tiles_collect(buf);
+    const struct termui_front *f = buf->front;
+    for (int row = y0; row < y1; row++) {
+        int lo = f->dirty_lo[row] > x0 ? f->dirty_lo[row] : x0;
+        int hi = f->dirty_hi[row] < x1 ? f->dirty_hi[row] : x1;
+        if (lo >= hi) continue;
+
+        size_t index = (size_t)row * (size_t)buf->width + (size_t)lo;
+        size_t a, b;
+        if (termui_cells_diff(buf->cells + index, f->cells + index, (size_t)(hi - lo), &a, &b)) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 void termui_buffer_get_size(const termui_buffer_t *buf, int *width, int *height) {
@@ -75,99 +426,409 @@ void termui_buffer_get_size(const termui_buffer_t *buf, int *width, int *height)
     if (height) *height = buf->height;
 }
 
+/* Glyph id for a legacy single-byte char; bytes >= 0x80 are Latin-1 */
+static unsigned int char_glyph(char c) {
+    unsigned char b = (unsigned char)c;
+    return b < 0x80 ? b : termui_glyph_from_codepoint(b);
+}
+
+/* Clip a rectangle to the buffer into [x0, x1) x [y0, y1)
+ * Returns false if nothing is left */
+static bool clip_rect(const termui_buffer_t *buf, int x, int y, int width, int height,
+                      int *x0, int *y0, int *x1, int *y1) {
+    *x0 = x < 0 ? 0 : x;
+    *y0 = y < 0 ? 0 : y;
+    *x1 = width > buf->width - x ? buf->width : x + width;
+    *y1 = height > buf->height - y ? buf->height : y + height;
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+/* Before overwriting from column x: if x is the right half of a wide
+ * glyph, blank the orphaned left half */
+static void split_left(termui_buffer_t *buf, int y, int x) {
+    termui_cell_t *row = row_cells(buf, y);
+    if (x > 0 && x < buf->width && termui_cell_glyph(row[x]) == TERMUI_GLYPH_CONT) {
+        row[x - 1] = (row[x - 1] & ~(termui_cell_t)TERMUI_CELL_GLYPH_MASK) | ' ';
+        mark_dirty(buf, y, x - 1, x);
+    }
+}
+
+/* After overwriting up to column x: if x is the right half of a wide
+ * glyph whose left half was overwritten, blank it */
+static void split_right(termui_buffer_t *buf, int y, int x) {
+    termui_cell_t *row = row_cells(buf, y);
+    if (x > 0 && x < buf->width && termui_cell_glyph(row[x]) == TERMUI_GLYPH_CONT &&
+        termui_glyph_width(termui_cell_glyph(row[x - 1])) != 2) {
+        row[x] = (row[x] & ~(termui_cell_t)TERMUI_CELL_GLYPH_MASK) | ' ';
+        mark_dirty(buf, y, x, x + 1);
+    }
+}
+
+/* Set one in-bounds-checked narrow cell */
+static void put_cell(termui_buffer_t *buf, int x, int y, termui_cell_t cell) {
+    if (x < 0 || x >= buf->width || y < 0 || y >= buf->height) return;
+
+    split_left(buf, y, x);
+    row_cells(buf, y)[x] = cell;
+    split_right(buf, y, x + 1);
+    mark_dirty(buf, y, x, x + 1);
+}
+
+/* Fill length cells of row y starting at x, clipped to the buffer */
+static void fill_span(termui_buffer_t *buf, int x, int y, int length, termui_cell_t cell) {
+    if (length <= 0 || y < 0 || y >= buf->height) return;
+
+    int x0 = x < 0 ? 0 : x;
+    int x1 = x + length > buf->width ? buf->width : x + length;
+    if (x0 >= x1) return;
+
+    split_left(buf, y, x0);
+    termui_cells_fill(row_cells(buf, y) + x0, cell, (size_t)(x1 - x0));
+    split_right(buf, y, x1);
+    mark_dirty(buf, y, x0, x1);
+}
+
+/* Fill length cells of column x starting at y, clipped to the buffer */
+static void fill_column(termui_buffer_t *buf, int x, int y, int length, termui_cell_t cell) {
+    int x0, y0, x1, y1;
+    if (length <= 0 || !clip_rect(buf, x, y, 1, length, &x0, &y0, &x1, &y1)) return;
+
+    termui_cell_t *p = row_cells(buf, y0) + x0;
+    for (int row = y0; row < y1; row++, p += buf->stride) {
+        split_left(buf, row, x0);
+        *p = cell;
+        split_right(buf, row, x1);
+        mark_dirty(buf, row, x0, x1);
+    }
+}
+
+/* Write single-byte text into row y from column x: at most len bytes,
+ * stopping at a NUL. Clipped before the loop, which never reads past
+ * the last visible byte */
+static void draw_bytes(termui_buffer_t *buf, int x, int y, const char *str, size_t len,
+                       termui_color_t color) {
+    if (y < 0 || y >= buf->height || x >= buf->width) return;
+
+    /* Bytes left of the buffer are skipped, but must exist */
+    size_t skip = x < 0 ? (size_t)-(long)x : 0;
+    for (size_t i = 0; i < skip; i++) {
+        if (i >= len || str[i] == '\0') return;
+    }
+
+    size_t room = (size_t)(buf->width - (x < 0 ? 0 : x));
+    size_t n = len - skip < room ? len - skip : room;
+    int x0 = x < 0 ? 0 : x;
+    termui_cell_t *row = row_cells(buf, y) + x0;
+    const char *src = str + skip;
+    if (n == 0 || src[0] == '\0') return;
+
+    split_left(buf, y, x0);
+    size_t i = 0;
+    while (i < n && src[i] != '\0') {
+        row[i] = termui_cell_make(char_glyph(src[i]), color);
+        i++;
+    }
+    split_right(buf, y, x0 + (int)i);
+    mark_dirty(buf, y, x0, x0 + (int)i);
+}
+
 void termui_buffer_draw_char(termui_buffer_t *buf, int x, int y, char c, termui_color_t color) {
     if (!buf) return;
-    if (x < 0 || x >= buf->width || y < 0 || y >= buf->height) return;
 
-    size_t index = (size_t)y * (size_t)buf->width + (size_t)x;
-    buf->chars[index] = c;
-    buf->colors[index] = color;
+    put_cell(buf, x, y, termui_cell_make(char_glyph(c), color));
 }
 
 void termui_buffer_draw_string(termui_buffer_t *buf, int x, int y, const char *str, termui_color_t color) {
     if (!buf || !str) return;
+
+    draw_bytes(buf, x, y, str, SIZE_MAX, color);
+}
+
+void termui_buffer_draw_text_n(termui_buffer_t *buf, int x, int y, const char *str, size_t len,
+                               termui_color_t color) {
+    if (!buf || !str) return;
+
+    draw_bytes(buf, x, y, str, len, color);
+}
+
+void termui_buffer_draw_codepoint(termui_buffer_t *buf, int x, int y, uint32_t codepoint, termui_color_t color) {
+    if (!buf) return;
+
+    char bytes[5] = {0};
+    if (codepoint < 0x80) {
+        bytes[0] = (char)codepoint;
+    } else {
+        unsigned int glyph = termui_glyph_from_codepoint(codepoint);
+        size_t len;
+        const char *src = termui_glyph_bytes(glyph, &len);
+        memcpy(bytes, src, len < 4 ? len : 4);
+    }
+    termui_buffer_draw_utf8(buf, x, y, bytes, color);
+}
+
+/* UTF-8 text in an interned style */
+static void draw_utf8_style(termui_buffer_t *buf, int x, int y, const char *str, unsigned int style) {
+    if (!buf || !str) return;
     if (y < 0 || y >= buf->height) return;
 
-    int i = 0;
-    while (str[i] != '\0') {
-        int px = x + i;
-        if (px >= 0 && px < buf->width) {
-            size_t index = (size_t)y * (size_t)buf->width + (size_t)px;
-            buf->chars[index] = str[i];
-            buf->colors[index] = color;
+    termui_cell_t *row = row_cells(buf, y);
+    termui_cell_t blank = termui_cell_make_styled(' ', style);
+    int x0 = x < 0 ? 0 : x;
+    int col = x;
+
+    if (x0 < buf->width) {
+        split_left(buf, y, x0);
+    }
+
+    while (*str && col < buf->width) {
+        unsigned int glyph;
+        int width;
+        str += termui_utf8_next_glyph(str, &glyph, &width);
+
+        if (col + width <= 0) {
+            col += width;  /* Entirely left of the buffer */
+            continue;
         }
-        i++;
+        if (col < 0) {
+            row[0] = blank;  /* Right half of a wide glyph cut by the left edge */
+        } else if (width == 2 && col + 1 >= buf->width) {
+            row[col] = blank;  /* Wide glyph cut by the right edge */
+        } else {
+            row[col] = termui_cell_make_styled(glyph, style);
+            if (width == 2) {
+                row[col + 1] = termui_cell_make_styled(TERMUI_GLYPH_CONT, style);
+            }
+        }
+        col += width;
+    }
+
+    int x1 = col > buf->width ? buf->width : col;
+    if (x0 < x1) {
+        split_right(buf, y, x1);
+        mark_dirty(buf, y, x0, x1);
     }
 }
 
-void termui_buffer_draw_hline(termui_buffer_t *buf, int x, int y, int length, char c, termui_color_t color) {
-    if (!buf || length <= 0) return;
+void termui_buffer_draw_utf8(termui_buffer_t *buf, int x, int y, const char *str, termui_color_t color) {
+    draw_utf8_style(buf, x, y, str, termui_cell_style(termui_cell_make(' ', color)));
+}
+
+void termui_buffer_draw_styled(termui_buffer_t *buf, int x, int y, const char *str,
+                               const termui_style_t *style) {
+    if (!buf || !str || !style) return;
     if (y < 0 || y >= buf->height) return;
 
-    for (int i = 0; i < length; i++) {
-        int px = x + i;
-        if (px >= 0 && px < buf->width) {
-            size_t index = (size_t)y * (size_t)buf->width + (size_t)px;
-            buf->chars[index] = c;
-            buf->colors[index] = color;
+    draw_utf8_style(buf, x, y, str, termui_style_intern(style));
+}
+
+void termui_buffer_set_style(termui_buffer_t *buf, int x, int y, int width, int height,
+                             const termui_style_t *style) {
+    int x0, y0, x1, y1;
+    if (!buf || !style || !clip_rect(buf, x, y, width, height, &x0, &y0, &x1, &y1)) return;
+
+    termui_cell_t bits = (termui_cell_t)termui_style_intern(style) << TERMUI_CELL_STYLE_SHIFT;
+    termui_cell_t mask = (termui_cell_t)TERMUI_CELL_STYLE_MASK << TERMUI_CELL_STYLE_SHIFT;
+    for (int row = y0; row < y1; row++) {
+        termui_cell_t *cells = row_cells(buf, row);
+        for (int col = x0; col < x1; col++) {
+            cells[col] = (cells[col] & ~mask) | bits;
         }
+        mark_dirty(buf, row, x0, x1);
     }
 }
 
-void termui_buffer_draw_vline(termui_buffer_t *buf, int x, int y, int length, char c, termui_color_t color) {
-    if (!buf || length <= 0) return;
-    if (x < 0 || x >= buf->width) return;
+void termui_buffer_put_cells(termui_buffer_t *buf, int x, int y, const termui_cell_t *cells, int n) {
+    int x0, y0, x1, y1;
+    if (!clip_rect(buf, x, y, n, 1, &x0, &y0, &x1, &y1)) return;
 
-    for (int i = 0; i < length; i++) {
-        int py = y + i;
-        if (py >= 0 && py < buf->height) {
-            size_t index = (size_t)py * (size_t)buf->width + (size_t)x;
-            buf->chars[index] = c;
-            buf->colors[index] = color;
-        }
+    split_left(buf, y0, x0);
+    memcpy(row_cells(buf, y0) + x0, cells + (x0 - x), (size_t)(x1 - x0) * sizeof(termui_cell_t));
+    split_right(buf, y0, x1);
+    mark_dirty(buf, y0, x0, x1);
+}
+
+void termui_buffer_fill_rect(termui_buffer_t *buf, int x, int y, int width, int height,
+                             char c, termui_color_t color) {
+    int x0, y0, x1, y1;
+    if (!buf || !clip_rect(buf, x, y, width, height, &x0, &y0, &x1, &y1)) return;
+
+    for (int row = y0; row < y1; row++) {
+        split_left(buf, row, x0);
+    }
+    termui_cells_fill_rect(row_cells(buf, y0) + x0, (size_t)buf->stride, (size_t)(x1 - x0),
+                           (size_t)(y1 - y0), termui_cell_make(char_glyph(c), color));
+    for (int row = y0; row < y1; row++) {
+        split_right(buf, row, x1);
+        mark_dirty(buf, row, x0, x1);
     }
 }
 
-void termui_buffer_draw_box(termui_buffer_t *buf, int x, int y, int width, int height, termui_color_t color) {
-    if (!buf || width < 2 || height < 2) return;
+/* Shapes: the rasterizer hands over clipped spans of one cell value */
+typedef struct {
+    termui_buffer_t *buf;
+    termui_cell_t cell;
+} shape_target_t;
 
-    /* Top and bottom lines */
-    termui_buffer_draw_hline(buf, x, y, width, '-', color);
-    termui_buffer_draw_hline(buf, x, y + height - 1, width, '-', color);
+static void shape_span(void *target, int x, int y, int length) {
+    shape_target_t *t = target;
+    fill_span(t->buf, x, y, length, t->cell);
+}
 
-    /* Left and right lines */
-    termui_buffer_draw_vline(buf, x, y, height, '|', color);
-    termui_buffer_draw_vline(buf, x + width - 1, y, height, '|', color);
+static termui_raster_t shape_raster(termui_buffer_t *buf, shape_target_t *t, char c, termui_color_t color) {
+    t->buf = buf;
+    t->cell = termui_cell_make(char_glyph(c), color);
+    termui_raster_t r = { buf->width, buf->height, shape_span, t };
+    return r;
+}
 
-    /* Corners */
-    termui_buffer_draw_char(buf, x, y, '+', color);
-    termui_buffer_draw_char(buf, x + width - 1, y, '+', color);
-    termui_buffer_draw_char(buf, x, y + height - 1, '+', color);
-    termui_buffer_draw_char(buf, x + width - 1, y + height - 1, '+', color);
+void termui_buffer_draw_line(termui_buffer_t *buf, int x0, int y0, int x1, int y1,
+                             char c, termui_color_t color) {
+    if (!buf) return;
+
+    shape_target_t t;
+    termui_raster_t r = shape_raster(buf, &t, c, color);
+    termui_raster_line(&r, x0, y0, x1, y1);
 }
 
-void termui_buffer_render(const termui_buffer_t *buf) {
-    if (!buf || !termui_is_initialized()) return;
+void termui_buffer_draw_polyline(termui_buffer_t *buf, const termui_point_t *points, int count,
+                                 char c, termui_color_t color) {
+    if (!buf || !points) return;
 
-    /* Move cursor to home */
-    move(0, 0);
+    shape_target_t t;
+    termui_raster_t r = shape_raster(buf, &t, c, color);
+    termui_raster_polyline(&r, points, count);
+}
 
-    /* Render each character with its color */
-    for (int y = 0; y < buf->height; y++) {
-        for (int x = 0; x < buf->width; x++) {
-            size_t index = (size_t)y * (size_t)buf->width + (size_t)x;
-            char ch = buf->chars[index];
-            termui_color_t color = buf->colors[index];
-
-            if (color > TERMUI_COLOR_DEFAULT && has_colors()) {
-                attron(COLOR_PAIR(color));
-                mvaddch(y, x, ch);
-                attroff(COLOR_PAIR(color));
-            } else {
-                mvaddch(y, x, ch);
-            }
+void termui_buffer_draw_circle(termui_buffer_t *buf, int cx, int cy, int radius,
+                               char c, termui_color_t color) {
+    if (!buf) return;
+
+    shape_target_t t;
+    termui_raster_t r = shape_raster(buf, &t, c, color);
+    termui_raster_circle(&r, cx, cy, radius);
+}
+
+void termui_buffer_fill_polygon(termui_buffer_t *buf, const termui_point_t *points, int count,
+                                char c, termui_color_t color) {
+    if (!buf || !points) return;
+
+    shape_target_t t;
+    termui_raster_t r = shape_raster(buf, &t, c, color);
+    termui_raster_polygon(&r, points, count);
+}
+
+void termui_buffer_blit(termui_buffer_t *dst, int dx, int dy, const termui_buffer_t *src,
+                        int sx, int sy, int width, int height) {
+    if (!dst || !src) return;
+
+    /* Clip the source rectangle, then its image in the destination */
+    int x0, y0, x1, y1;
+    if (!clip_rect(src, sx, sy, width, height, &x0, &y0, &x1, &y1)) return;
+    dx += x0 - sx;
+    dy += y0 - sy;
+    sx = x0;
+    sy = y0;
+    if (!clip_rect(dst, dx, dy, x1 - x0, y1 - y0, &x0, &y0, &x1, &y1)) return;
+    sx += x0 - dx;
+    sy += y0 - dy;
+
+    int w = x1 - x0;
+    int rows = y1 - y0;
+    const termui_cell_t *from = src->cells + (size_t)sy * (size_t)src->stride + (size_t)sx;
+    termui_cell_t *to = row_cells(dst, y0) + x0;
+
+    /* Within one buffer, copy bottom-up when moving down so rows are
+     * read before they are overwritten */
+    uintptr_t a = (uintptr_t)to;
+    uintptr_t b = (uintptr_t)from;
+    int first = 0, step = 1;
+    if (a > b && a < b + (size_t)rows * (size_t)src->stride * sizeof(termui_cell_t)) {
+        first = rows - 1;
+        step = -1;
+    }
+
+    termui_cell_t mask = ~(termui_cell_t)TERMUI_CELL_GLYPH_MASK;
+    for (int i = 0, r = first; i < rows; i++, r += step) {
+        int row = y0 + r;
+        termui_cell_t *out = to + (size_t)r * (size_t)dst->stride;
+        memmove(out, from + (size_t)r * (size_t)src->stride, (size_t)w * sizeof(termui_cell_t));
+
+        /* Wide glyphs cut by either rectangle lose their other half.
+         * Fixed up after the copy, as the source may be this row */
+        if (termui_cell_glyph(out[0]) == TERMUI_GLYPH_CONT) {
+            out[0] = (out[0] & mask) | ' ';
+        }
+        if (termui_glyph_width(termui_cell_glyph(out[w - 1])) == 2) {
+            out[w - 1] = (out[w - 1] & mask) | ' ';
+        }
+        int lo = x0;
+        if (x0 > 0 && termui_glyph_width(termui_cell_glyph(out[-1])) == 2) {
+            out[-1] = (out[-1] & mask) | ' ';
+            lo--;
         }
+        split_right(dst, row, x1);
+        mark_dirty(dst, row, lo, x1);
     }
+}
+
+int termui_utf8_width(const char *str) {
+    if (!str) return 0;
+
+    int width = 0;
+    while (*str) {
+        uint32_t cp;
+        str += termui_utf8_decode(str, &cp);
+        width += termui_codepoint_width(cp);
+    }
+    return width;
+}
+
+void termui_buffer_draw_hline(termui_buffer_t *buf, int x, int y, int length, char c, termui_color_t color) {
+    if (!buf) return;
+
+    fill_span(buf, x, y, length, termui_cell_make(char_glyph(c), color));
+}
+
+void termui_buffer_draw_vline(termui_buffer_t *buf, int x, int y, int length, char c, termui_color_t color) {
+    if (!buf) return;
+
+    fill_column(buf, x, y, length, termui_cell_make(char_glyph(c), color));
+}
 
-    refresh();
+void termui_buffer_draw_box(termui_buffer_t *buf, int x, int y, int width, int height, termui_color_t color) {
+    termui_buffer_draw_box_style(buf, x, y, width, height, TERMUI_BOX_ASCII, color);
+}
+
+/* Box glyphs per style: horizontal, vertical, then corners TL, TR, BL, BR */
+static const uint32_t g_box_glyphs[][6] = {
+    [TERMUI_BOX_ASCII]   = {'-', '|', '+', '+', '+', '+'},
+    [TERMUI_BOX_LIGHT]   = {0x2500, 0x2502, 0x250c, 0x2510, 0x2514, 0x2518},
+    [TERMUI_BOX_HEAVY]   = {0x2501, 0x2503, 0x250f, 0x2513, 0x2517, 0x251b},
+    [TERMUI_BOX_DOUBLE]  = {0x2550, 0x2551, 0x2554, 0x2557, 0x255a, 0x255d},
+    [TERMUI_BOX_ROUNDED] = {0x2500, 0x2502, 0x256d, 0x256e, 0x2570, 0x256f}
+};
+
+void termui_buffer_draw_box_style(termui_buffer_t *buf, int x, int y, int width, int height,
+                                  termui_box_style_t style, termui_color_t color) {
+    if (!buf || width < 2 || height < 2) return;
+    if ((unsigned int)style > TERMUI_BOX_ROUNDED) style = TERMUI_BOX_ASCII;
+
+    termui_cell_t g[6];
+    for (int i = 0; i < 6; i++) {
+        g[i] = termui_cell_make(termui_glyph_from_codepoint(g_box_glyphs[style][i]), color);
+    }
+
+    /* Top and bottom lines */
+    fill_span(buf, x + 1, y, width - 2, g[0]);
+    fill_span(buf, x + 1, y + height - 1, width - 2, g[0]);
+
+    /* Left and right lines */
+    fill_column(buf, x, y + 1, height - 2, g[1]);
+    fill_column(buf, x + width - 1, y + 1, height - 2, g[1]);
+
+    /* Corners */
+    put_cell(buf, x, y, g[2]);
+    put_cell(buf, x + width - 1, y, g[3]);
+    put_cell(buf, x, y + height - 1, g[4]);
+    put_cell(buf, x + width - 1, y + height - 1, g[5]);
 }
@@ -0,0 +1,291 @@
+/*
+ * termui - Sub-cell Canvas
+ *
+ * A pixel grid drawn with block glyphs: each cell holds a 2x4 braille
+ * pattern or a 2x2 quadrant block. Pixels live in one bitmap byte per
+ * cell, laid out so the byte is the glyph: braille dots use the bit
+ * order of U+2800..U+28FF, quadrants index a 16-entry table. Setting or
+ * clearing a pixel is a bit operation on that byte.
+ *
+ * Cells touched since the last draw are tracked per row, and only those
+ * are converted to glyphs and written into the buffer, so the per-frame
+ * cost follows what changed, not the canvas size.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Bit of each pixel within a cell, by [row][column] */
+static const uint8_t g_braille_bits[4][2] = {
+    {0x01, 0x08},
+    {0x02, 0x10},
+    {0x04, 0x20},
+    {0x40, 0x80}
+};
+
+static const uint8_t g_quadrant_bits[2][2] = {
+    {0x1, 0x2},
+    {0x4, 0x8}
+};
+
+/* Quadrant glyph for each bitmap: TL 1, TR 2, BL 4, BR 8 */
+static const uint32_t g_quadrant_glyphs[16] = {
+    ' ',    0x2598, 0x259d, 0x2580, 0x2596, 0x258c, 0x259e, 0x259b,
+    0x2597, 0x259a, 0x2590, 0x259c, 0x2584, 0x2599, 0x259f, 0x2588
+};
+
+struct termui_canvas {
+    termui_canvas_mode_t mode;
+    int columns;                /* Size in cells */
+    int rows;
+    int shift_y;                /* log2 of pixel rows per cell */
+    uint8_t *bits;              /* Pixel bitmap per cell, row-major */
+    uint8_t *colors;            /* Color of each cell's pixels */
+    int *dirty_lo;              /* Per row: first changed cell (columns if clean) */
+    int *dirty_hi;              /* Per row: one past last changed cell (0 if clean) */
+    termui_cell_t *scratch;     /* One row of converted cells */
+    unsigned int glyphs[256];   /* Glyph id per bitmap, 0 until interned */
+
+    /* Where the canvas was last drawn; elsewhere redraws everything */
+    const termui_buffer_t *target;
+    int target_x, target_y;
+};
+
+static void mark_all_dirty(termui_canvas_t *canvas) {
+    for (int y = 0; y < canvas->rows; y++) {
+        canvas->dirty_lo[y] = 0;
+        canvas->dirty_hi[y] = canvas->columns;
+    }
+}
+
+termui_canvas_t* termui_canvas_create(int columns, int rows, termui_canvas_mode_t mode) {
+    if (columns <= 0 || rows <= 0 ||
+        (mode != TERMUI_CANVAS_BRAILLE && mode != TERMUI_CANVAS_QUADRANT)) {
+        return NULL;
+    }
+
+    termui_canvas_t *canvas = calloc(1, sizeof(termui_canvas_t));
+    if (!canvas) {
+        return NULL;
+    }
+
+    size_t cells = (size_t)columns * (size_t)rows;
+    canvas->mode = mode;
+    canvas->columns = columns;
+    canvas->rows = rows;
+    canvas->shift_y = mode == TERMUI_CANVAS_BRAILLE ? 2 : 1;
+    canvas->bits = calloc(cells, 1);
+    canvas->colors = calloc(cells, 1);
+    canvas->dirty_lo = malloc((size_t)rows * sizeof(int));
+    canvas->dirty_hi = malloc((size_t)rows * sizeof(int));
+    canvas->scratch = malloc((size_t)columns * sizeof(termui_cell_t));
+    if (!canvas->bits || !canvas->colors || !canvas->dirty_lo || !canvas->dirty_hi || !canvas->scratch) {
+        termui_canvas_destroy(canvas);
+        return NULL;
+    }
+
+    mark_all_dirty(canvas);
+    return canvas;
+}
+
+void termui_canvas_destroy(termui_canvas_t *canvas) {
+    if (!canvas) return;
+
+    free(canvas->bits);
+    free(canvas->colors);
+    free(canvas->dirty_lo);
+    free(canvas->dirty_hi);
+    free(canvas->scratch);
+    free(canvas);
+}
+
+void termui_canvas_get_size(const termui_canvas_t *canvas, int *width, int *height) {
+    if (width) *width = canvas ? canvas->columns * 2 : 0;
+    if (height) *height = canvas ? canvas->rows << canvas->shift_y : 0;
+}
+
+/* Cell index and bit of pixel (x, y); false if outside the canvas */
+static bool locate(const termui_canvas_t *canvas, int x, int y, size_t *cell, uint8_t *bit) {
+    if (x < 0 || y < 0 || x >= canvas->columns * 2 || y >= canvas->rows << canvas->shift_y) {
+        return false;
+    }
+
+    int row = y >> canvas->shift_y;
+    *cell = (size_t)row * (size_t)canvas->columns + (size_t)(x >> 1);
+    if (canvas->mode == TERMUI_CANVAS_BRAILLE) {
+        *bit = g_braille_bits[y & 3][x & 1];
+    } else {
+        *bit = g_quadrant_bits[y & 1][x & 1];
+    }
+    return true;
+}
+
+static void mark_dirty(termui_canvas_t *canvas, size_t cell) {
+    int row = (int)(cell / (size_t)canvas->columns);
+    int col = (int)(cell % (size_t)canvas->columns);
+    if (col < canvas->dirty_lo[row]) canvas->dirty_lo[row] = col;
+    if (col + 1 > canvas->dirty_hi[row]) canvas->dirty_hi[row] = col + 1;
+}
+
+void termui_canvas_set(termui_canvas_t *canvas, int x, int y, termui_color_t color) {
+    size_t cell;
+    uint8_t bit;
+    if (!canvas || !locate(canvas, x, y, &cell, &bit)) return;
+
+    uint8_t old = canvas->bits[cell];
+    canvas->bits[cell] = old | bit;
+    if (canvas->bits[cell] != old || canvas->colors[cell] != (uint8_t)color) {
+        canvas->colors[cell] = (uint8_t)color;
+        mark_dirty(canvas, cell);
+    }
+}
+
+void termui_canvas_unset(termui_canvas_t *canvas, int x, int y) {
+    size_t cell;
+    uint8_t bit;
+    if (!canvas || !locate(canvas, x, y, &cell, &bit)) return;
+
+    if (canvas->bits[cell] & bit) {
+        canvas->bits[cell] &= (uint8_t)~bit;
+        mark_dirty(canvas, cell);
+    }
+}
+
+bool termui_canvas_get(const termui_canvas_t *canvas, int x, int y) {
+    size_t cell;
+    uint8_t bit;
+    if (!canvas || !locate(canvas, x, y, &cell, &bit)) return false;
+
+    return (canvas->bits[cell] & bit) != 0;
+}
+
+void termui_canvas_clear(termui_canvas_t *canvas) {
+    if (!canvas) return;
+
+    /* Only rows that had pixels need redrawing */
+    for (int y = 0; y < canvas->rows; y++) {
+        uint8_t *row = canvas->bits + (size_t)y * (size_t)canvas->columns;
+        int lo = 0;
+        int hi = canvas->columns;
+        while (lo < hi && row[lo] == 0) lo++;
+        while (hi > lo && row[hi - 1] == 0) hi--;
+        if (lo < hi) {
+            memset(row + lo, 0, (size_t)(hi - lo));
+            if (lo < canvas->dirty_lo[y]) canvas->dirty_lo[y] = lo;
+            if (hi > canvas->dirty_hi[y]) canvas->dirty_hi[y] = hi;
+        }
+    }
+}
+
+/* Shapes: set the pixels of each clipped span */
+typedef struct {
+    termui_canvas_t *canvas;
+    termui_color_t color;
+} shape_target_t;
+
+static void shape_span(void *target, int x, int y, int length) {
+    shape_target_t *t = target;
+    termui_canvas_t *canvas = t->canvas;
+    const uint8_t *bits = canvas->mode == TERMUI_CANVAS_BRAILLE ? g_braille_bits[y & 3] : g_quadrant_bits[y & 1];
+    int row = y >> canvas->shift_y;
+    size_t base = (size_t)row * (size_t)canvas->columns;
+
+    for (int px = x; px < x + length; px++) {
+        size_t cell = base + (size_t)(px >> 1);
+        canvas->bits[cell] |= bits[px & 1];
+        canvas->colors[cell] = (uint8_t)t->color;
+    }
+
+    int lo = x >> 1;
+    int hi = ((x + length - 1) >> 1) + 1;
+    if (lo < canvas->dirty_lo[row]) canvas->dirty_lo[row] = lo;
+    if (hi > canvas->dirty_hi[row]) canvas->dirty_hi[row] = hi;
+}
+
+static termui_raster_t shape_raster(termui_canvas_t *canvas, shape_target_t *t, termui_color_t color) {
+    t->canvas = canvas;
+    t->color = color;
+    termui_raster_t r = { canvas->columns * 2, canvas->rows << canvas->shift_y, shape_span, t };
+    return r;
+}
+
+void termui_canvas_draw_line(termui_canvas_t *canvas, int x0, int y0, int x1, int y1, termui_color_t color) {
+    if (!canvas) return;
+
+    shape_target_t t;
+    termui_raster_t r = shape_raster(canvas, &t, color);
+    termui_raster_line(&r, x0, y0, x1, y1);
+}
+
+void termui_canvas_draw_polyline(termui_canvas_t *canvas, const termui_point_t *points, int count,
+                                 termui_color_t color) {
+    if (!canvas || !points) return;
+
+    shape_target_t t;
+    termui_raster_t r = shape_raster(canvas, &t, color);
+    termui_raster_polyline(&r, points, count);
+}
+
+void termui_canvas_draw_circle(termui_canvas_t *canvas, int cx, int cy, int radius, termui_color_t color) {
+    if (!canvas) return;
+
+    shape_target_t t;
+    termui_raster_t r = shape_raster(canvas, &t, color);
+    termui_raster_circle(&r, cx, cy, radius);
+}
+
+void termui_canvas_fill_polygon(termui_canvas_t *canvas, const termui_point_t *points, int count,
+                                termui_color_t color) {
+    if (!canvas || !points) return;
+
+    shape_target_t t;
+    termui_raster_t r = shape_raster(canvas, &t, color);
+    termui_raster_polygon(&r, points, count);
+}
+
+/* Glyph id of a cell bitmap (a space when empty) */
+static unsigned int cell_glyph(termui_canvas_t *canvas, uint8_t bits) {
+    if (bits == 0) {
+        return ' ';
+    }
+    if (canvas->glyphs[bits] == 0) {
+        uint32_t cp = canvas->mode == TERMUI_CANVAS_BRAILLE ? 0x2800u + bits : g_quadrant_glyphs[bits];
+        canvas->glyphs[bits] = termui_glyph_from_codepoint(cp);
+    }
+    return canvas->glyphs[bits];
+}
+
+void termui_canvas_draw(termui_canvas_t *canvas, termui_buffer_t *buf, int x, int y) {
+    if (!canvas || !buf) return;
+
+    if (canvas->target != buf || canvas->target_x != x || canvas->target_y != y) {
+        mark_all_dirty(canvas);
+        canvas->target = buf;
+        canvas->target_x = x;
+        canvas->target_y = y;
+    }
+
+    for (int row = 0; row < canvas->rows; row++) {
+        int lo = canvas->dirty_lo[row];
+        int hi = canvas->dirty_hi[row];
+        if (lo >= hi) continue;
+
+        size_t base = (size_t)row * (size_t)canvas->columns;
+        for (int col = lo; col < hi; col++) {
+            uint8_t bits = canvas->bits[base + (size_t)col];
+            canvas->scratch[col] = termui_cell_make(cell_glyph(canvas, bits),
+                                                    (termui_color_t)canvas->colors[base + (size_t)col]);
+        }
+        termui_buffer_put_cells(buf, x + lo, y + row, canvas->scratch + lo, hi - lo);
+
+        canvas->dirty_lo[row] = canvas->columns;
+        canvas->dirty_hi[row] = 0;
+    }
+}
+
+void termui_canvas_invalidate(termui_canvas_t *canvas) {
+    if (!canvas) return;
+    mark_all_dirty(canvas);
+}
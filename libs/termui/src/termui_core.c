@@ -8,28 +8,56 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "termui.h"
+#include "termui_internal.h"
 #include <ncurses.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
 
 /* Global state */
 static bool g_initialized = false;
 static termui_config_t g_config;
 static volatile sig_atomic_t g_resize_pending = 0;
 static int g_last_raw_key = 0;
+static unsigned long g_screen_epoch = 0;    /* Accessed atomically */
+
+/* Serializes terminal I/O when a render thread presents frames */
+static pthread_mutex_t g_output_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Actions queued by gamepads, oldest first */
+#define INPUT_QUEUE_SIZE 64
+static termui_input_event_t g_queue[INPUT_QUEUE_SIZE];
+static int g_queue_head = 0;
+static int g_queue_count = 0;
 
 /* Signal handler for SIGWINCH */
 static void handle_winch(int sig) {
     (void)sig;
-    g_resize_pending = 1;
+    termui_resize_notify();
+}
+
+/* Set up resize signal handler */
+static void install_winch_handler(void) {
+    struct sigaction sa;
+    sa.sa_handler = handle_winch;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGWINCH, &sa, NULL);
 }
 
 termui_config_t termui_default_config(void) {
     termui_config_t config = {
         .colors_enabled = true,
         .mouse_enabled = false,
-        .raw_keys = false
+        .raw_keys = false,
+        .backend = TERMUI_BACKEND_NCURSES,
+        .headless_width = 80,
+        .headless_height = 24,
+        .color_mode = TERMUI_COLORS_AUTO
     };
     return config;
 }
@@ -46,8 +74,49 @@ int termui_init(const termui_config_t *config) {
         g_config = termui_default_config();
     }
 
+    /* Glyph width table, built once */
+    termui_glyph_init();
+
+    /* Color depth for extended styles */
+    termui_style_init(g_config.color_mode);
+
+    /* Self-pipe for input waits, written by the SIGWINCH handler */
+    if (termui_event_init() != TERMUI_OK) {
+        return TERMUI_ERROR;
+    }
+
+    if (g_config.backend == TERMUI_BACKEND_HEADLESS) {
+        /* No tty at all: encoder output feeds the in-memory screen */
+        int rc = termui_headless_init(g_config.headless_width, g_config.headless_height);
+        if (rc == TERMUI_OK) {
+            rc = termui_ansi_init(true);
+        }
+        if (rc != TERMUI_OK) {
+            termui_headless_cleanup();
+            termui_event_cleanup();
+            return rc;
+        }
+        termui_screen_touch();
+        g_initialized = true;
+        return TERMUI_OK;
+    }
+
+    if (g_config.backend == TERMUI_BACKEND_ANSI) {
+        /* Direct output - ncurses is never started */
+        int rc = termui_ansi_init(false);
+        if (rc != TERMUI_OK) {
+            termui_event_cleanup();
+            return rc;
+        }
+        install_winch_handler();
+        termui_screen_touch();
+        g_initialized = true;
+        return TERMUI_OK;
+    }
+
     /* Initialize ncurses */
     if (initscr() == NULL) {
+        termui_event_cleanup();
         return TERMUI_ERROR;
     }
 
@@ -80,13 +149,9 @@ int termui_init(const termui_config_t *config) {
 #endif
     }
 
-    /* Set up resize signal handler */
-    struct sigaction sa;
-    sa.sa_handler = handle_winch;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGWINCH, &sa, NULL);
+    install_winch_handler();
 
+    termui_screen_touch();
     g_initialized = true;
     return TERMUI_OK;
 }
@@ -97,11 +162,19 @@ void termui_cleanup(void) {
     }
 
     /* Restore terminal to normal mode */
-    if (!isendwin()) {
+    if (g_config.backend == TERMUI_BACKEND_HEADLESS) {
+        termui_ansi_cleanup();
+        termui_headless_cleanup();
+    } else if (g_config.backend == TERMUI_BACKEND_ANSI) {
+        termui_ansi_cleanup();
+    } else if (!isendwin()) {
         curs_set(1);  /* Show cursor */
         endwin();     /* End ncurses mode */
     }
 
+    termui_gamepad_disconnect_all();
+    termui_event_cleanup();
+    g_queue_count = 0;
     g_initialized = false;
 }
 
@@ -116,6 +189,11 @@ void termui_get_size(int *width, int *height) {
         return;
     }
 
+    if (termui_backend_encodes()) {
+        termui_ansi_get_size(width, height);
+        return;
+    }
+
     int h, w;
     getmaxyx(stdscr, h, w);
     if (width) *width = w;
@@ -128,12 +206,70 @@ bool termui_check_resize(void) {
     }
 
     g_resize_pending = 0;
-    endwin();
-    refresh();
-    clear();
+    termui_output_lock();
+    if (termui_backend_encodes()) {
+        /* Usually the last frame survives, and buffers resized to match
+         * (termui_buffer_resize) send only the cells that changed */
+        int width, height;
+        termui_ansi_get_size(&width, &height);
+        if (!termui_ansi_resize_keeps(height)) {
+            termui_ansi_clear();
+            termui_screen_touch();
+        }
+    } else {
+        /* resizeterm keeps stdscr's contents, and ncurses only sends what
+         * the repaint changes; endwin+refresh re-reads the size instead */
+        struct winsize ws;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0 || ws.ws_col == 0 || ws.ws_row == 0 ||
+            resizeterm(ws.ws_row, ws.ws_col) != OK) {
+            endwin();
+            refresh();
+            clear();
+        }
+        termui_screen_touch();
+    }
+    termui_output_unlock();
     return true;
 }
 
+termui_backend_t termui_active_backend(void) {
+    return g_config.backend;
+}
+
+bool termui_backend_encodes(void) {
+    return g_config.backend == TERMUI_BACKEND_ANSI ||
+           g_config.backend == TERMUI_BACKEND_HEADLESS;
+}
+
+void termui_resize_notify(void) {
+    /* Async-signal-safe: called from the SIGWINCH handler */
+    g_resize_pending = 1;
+    termui_input_wake();
+}
+
+bool termui_colors_active(void) {
+    if (termui_backend_encodes()) {
+        return g_config.colors_enabled;
+    }
+    return has_colors();
+}
+
+unsigned long termui_screen_epoch(void) {
+    return __atomic_load_n(&g_screen_epoch, __ATOMIC_ACQUIRE);
+}
+
+unsigned long termui_screen_touch(void) {
+    return __atomic_add_fetch(&g_screen_epoch, 1, __ATOMIC_ACQ_REL);
+}
+
+void termui_output_lock(void) {
+    pthread_mutex_lock(&g_output_lock);
+}
+
+void termui_output_unlock(void) {
+    pthread_mutex_unlock(&g_output_lock);
+}
+
 const char* termui_version(void) {
     return TERMUI_VERSION;
 }
@@ -149,30 +285,50 @@ const char* termui_error_string(int code) {
     }
 }
 
-/* Input polling implementation */
-termui_input_t termui_input_poll(void) {
-    if (!g_initialized) {
-        return TERMUI_INPUT_NONE;
-    }
-
-    /* Check for resize first */
-    if (g_resize_pending) {
-        return TERMUI_INPUT_RESIZE;
+/* Read one key from the active backend without blocking (ERR if none) */
+static int read_key(void) {
+    if (termui_backend_encodes()) {
+        return termui_ansi_getch();
     }
 
+    /* getch may refresh stdscr, so it must not race a render thread */
+    termui_output_lock();
     int ch = getch();
-    g_last_raw_key = ch;
+    termui_output_unlock();
+    return ch;
+}
 
-    if (ch == ERR) {
-        return TERMUI_INPUT_NONE;
+void termui_input_push(termui_input_t input, uint64_t time_ns) {
+    if (g_queue_count == INPUT_QUEUE_SIZE) {
+        return;  /* Full - the app has stopped reading input */
     }
 
-    /* If raw keys mode, let caller handle mapping */
-    if (g_config.raw_keys) {
-        return TERMUI_INPUT_NONE;  /* Caller should check termui_input_raw_key() */
+    int tail = (g_queue_head + g_queue_count) % INPUT_QUEUE_SIZE;
+    g_queue[tail] = (termui_input_event_t){ input, ERR, 1, time_ns };
+    g_queue_count++;
+}
+
+bool termui_input_queued(void) {
+    return g_queue_count > 0;
+}
+
+/* Take the oldest queued action; gamepads are read first */
+static bool queue_pop(termui_input_event_t *event) {
+    if (g_queue_count == 0) {
+        termui_gamepad_pump();
+    }
+    if (g_queue_count == 0) {
+        return false;
     }
 
-    /* Map keys to actions */
+    *event = g_queue[g_queue_head];
+    g_queue_head = (g_queue_head + 1) % INPUT_QUEUE_SIZE;
+    g_queue_count--;
+    return true;
+}
+
+/* Map a key code to an action */
+static termui_input_t map_key(int ch) {
     switch (ch) {
         case 27: /* ESC */
         case 'q':
@@ -221,6 +377,158 @@ termui_input_t termui_input_poll(void) {
     }
 }
 
+/* Input polling implementation */
+termui_input_t termui_input_poll(void) {
+    if (!g_initialized) {
+        return TERMUI_INPUT_NONE;
+    }
+
+    /* Check for resize first */
+    if (g_resize_pending) {
+        return TERMUI_INPUT_RESIZE;
+    }
+
+    termui_input_event_t queued;
+    if (queue_pop(&queued)) {
+        g_last_raw_key = queued.key;
+        termui_stats_note_input(1);
+        return queued.input;
+    }
+
+    int ch = read_key();
+    g_last_raw_key = ch;
+
+    if (ch == ERR) {
+        return TERMUI_INPUT_NONE;
+    }
+    termui_stats_note_input(1);
+
+    /* If raw keys mode, let caller handle mapping */
+    if (g_config.raw_keys) {
+        return TERMUI_INPUT_NONE;  /* Caller should check termui_input_raw_key() */
+    }
+
+    return map_key(ch);
+}
+
+/* Actions that auto-repeat while a key is held */
+static bool is_movement(termui_input_t input) {
+    switch (input) {
+        case TERMUI_INPUT_UP:
+        case TERMUI_INPUT_DOWN:
+        case TERMUI_INPUT_LEFT:
+        case TERMUI_INPUT_RIGHT:
+        case TERMUI_INPUT_ZOOM_IN:
+        case TERMUI_INPUT_ZOOM_OUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+int termui_input_drain(termui_input_event_t *events, int max, int flags) {
+    if (!g_initialized || !events || max <= 0) {
+        return 0;
+    }
+
+    int n = 0;
+    int taken = 0;      /* Events read, before coalescing */
+
+    /* A pending resize is reported once, ahead of the keys */
+    if (g_resize_pending) {
+        events[n++] = (termui_input_event_t){ TERMUI_INPUT_RESIZE, ERR, 1, now_ns() };
+    }
+
+    while (n < max) {
+        termui_input_event_t event;
+
+        /* Gamepad actions were queued before any key still unread */
+        if (!queue_pop(&event)) {
+            int ch = read_key();
+            if (ch == ERR) {
+                break;
+            }
+            g_last_raw_key = ch;
+
+            termui_input_t input = g_config.raw_keys ? TERMUI_INPUT_NONE : map_key(ch);
+            if (input == TERMUI_INPUT_NONE && !g_config.raw_keys) {
+                continue;  /* Unmapped key */
+            }
+            event = (termui_input_event_t){ input, ch, 1, now_ns() };
+        }
+        taken++;
+
+        /* Fold auto-repeat into the previous event */
+        if ((flags & TERMUI_DRAIN_COALESCE) && n > 0 && is_movement(event.input) &&
+            events[n - 1].input == event.input) {
+            events[n - 1].count++;
+            continue;
+        }
+
+        events[n++] = event;
+    }
+
+    termui_stats_note_input(taken);
+    return n;
+}
+
 int termui_input_raw_key(void) {
     return g_last_raw_key;
 }
+
+termui_input_t termui_input_wait(int timeout_ms) {
+    if (!g_initialized) {
+        return TERMUI_INPUT_NONE;
+    }
+
+    /* Keys that are dropped restart the wait, so it runs to a deadline */
+    uint64_t deadline = timeout_ms >= 0 ? now_ns() + (uint64_t)timeout_ms * 1000000u : 0;
+    bool waited = false;
+
+    for (;;) {
+        /* Drain what is already buffered (ncurses or ANSI decoder) first,
+         * so poll() is only entered with nothing left to read */
+        termui_input_t input = termui_input_poll();
+        if (input != TERMUI_INPUT_NONE) {
+            return input;
+        }
+        if (g_last_raw_key != ERR) {
+            if (g_config.raw_keys) {
+                return TERMUI_INPUT_NONE;  /* Caller checks termui_input_raw_key() */
+            }
+            continue;  /* Unmapped key - keep waiting */
+        }
+
+        /* Headless input is pushed in memory and arrives as a wake */
+        int remaining = -1;
+        if (timeout_ms >= 0) {
+            uint64_t now = now_ns();
+            if (now >= deadline && waited) {
+                return g_resize_pending ? TERMUI_INPUT_RESIZE : TERMUI_INPUT_NONE;
+            }
+            remaining = now >= deadline ? 0 : (int)((deadline - now + 999999u) / 1000000u);
+        }
+        waited = true;
+
+        /* A held partial escape sequence is decided once its delay ends */
+        int esc = termui_ansi_input_delay();
+        if (esc >= 0 && (remaining < 0 || esc < remaining)) {
+            remaining = esc;
+        }
+
+        int input_fd = g_config.backend == TERMUI_BACKEND_HEADLESS ? -1 : STDIN_FILENO;
+        if (!termui_event_wait(input_fd, remaining)) {
+            if (g_queue_count > 0 || termui_ansi_has_input()) {
+                continue;  /* A gamepad reported, headless input was pushed, or ESC timed out */
+            }
+            /* Timeout, wake or callbacks; a resize is reported now */
+            return g_resize_pending ? TERMUI_INPUT_RESIZE : TERMUI_INPUT_NONE;
+        }
+    }
+}
@@ -0,0 +1,491 @@
+/*
+ * termui - Retained Display List
+ *
+ * Named groups of recorded draw commands, each owning a rectangle of a
+ * target buffer. A group is re-recorded only when the app's version key
+ * for it changes, and replayed only then: its rectangle is cleared and
+ * the commands are drawn into a view of it, clipped and in group-local
+ * coordinates. Unchanged groups cost nothing per frame, and the target's
+ * damage map only sees the cells of groups that were replayed.
+ *
+ * Groups are replayed in creation order, so later groups draw over
+ * earlier ones. Replaying a group also replays the later groups that
+ * overlap it, and moving or removing a group replays every group that
+ * overlapped its old rectangle.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    CMD_CHAR,
+    CMD_STRING,
+    CMD_FILL_RECT,
+    CMD_UTF8,
+    CMD_STYLED,
+    CMD_CODEPOINT,
+    CMD_HLINE,
+    CMD_VLINE,
+    CMD_BOX,
+    CMD_BOX_STYLE,
+    CMD_SET_STYLE
+} cmd_type_t;
+
+/* One recorded call; text lives in the group's string pool */
+typedef struct {
+    cmd_type_t type;
+    int x, y;
+    int w, h;                   /* Box and style size, line length */
+    termui_color_t color;
+    termui_box_style_t box;
+    termui_style_t style;
+    uint32_t value;             /* Character or codepoint */
+    size_t text;                /* Offset into the pool */
+} draw_cmd_t;
+
+struct termui_group {
+    char *name;
+    int x, y, width, height;
+    uint64_t key;
+    bool recorded;              /* key and commands are valid */
+    bool recording;             /* Between a successful begin and replay */
+    bool dirty;                 /* Replay on the next termui_display_list_replay */
+
+    draw_cmd_t *cmds;
+    int count;
+    int capacity;
+    char *pool;
+    size_t pool_len;
+    size_t pool_cap;
+};
+
+struct termui_display_list {
+    termui_buffer_t *target;
+    termui_group_t **groups;    /* Creation order, bottom first */
+    int count;
+    int capacity;
+};
+
+static bool rects_overlap(const termui_group_t *g, int x, int y, int w, int h) {
+    return g->x < x + w && x < g->x + g->width && g->y < y + h && y < g->y + g->height;
+}
+
+/* Replay every group overlapping a rectangle */
+static void damage_groups(termui_display_list_t *list, int x, int y, int w, int h) {
+    for (int i = 0; i < list->count; i++) {
+        if (rects_overlap(list->groups[i], x, y, w, h)) {
+            list->groups[i]->dirty = true;
+        }
+    }
+}
+
+/* Blank a rectangle of the target, clipped */
+static void clear_rect(termui_buffer_t *target, int x, int y, int w, int h) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > target->width ? target->width : x + w;
+    int y1 = y + h > target->height ? target->height : y + h;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    termui_buffer_t *view = termui_buffer_view_create(target, x0, y0, x1 - x0, y1 - y0);
+    if (view) {
+        termui_buffer_clear(view);
+        termui_buffer_view_commit(view, target, x0, y0);
+        termui_buffer_view_destroy(view);
+    }
+}
+
+termui_display_list_t* termui_display_list_create(termui_buffer_t *target) {
+    if (!target || target->view) {
+        return NULL;
+    }
+
+    termui_display_list_t *list = calloc(1, sizeof(termui_display_list_t));
+    if (!list) {
+        return NULL;
+    }
+    list->target = target;
+    return list;
+}
+
+static void group_free(termui_group_t *g) {
+    free(g->name);
+    free(g->cmds);
+    free(g->pool);
+    free(g);
+}
+
+void termui_display_list_destroy(termui_display_list_t *list) {
+    if (!list) return;
+
+    for (int i = 0; i < list->count; i++) {
+        group_free(list->groups[i]);
+    }
+    free(list->groups);
+    free(list);
+}
+
+termui_group_t* termui_display_list_group(termui_display_list_t *list, const char *name,
+                                          int x, int y, int width, int height) {
+    if (!list || !name || width <= 0 || height <= 0) {
+        return NULL;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        termui_group_t *g = list->groups[i];
+        if (strcmp(g->name, name) != 0) continue;
+
+        if (g->x != x || g->y != y || g->width != width || g->height != height) {
+            /* Moved or resized: uncover the old rectangle */
+            damage_groups(list, g->x, g->y, g->width, g->height);
+            clear_rect(list->target, g->x, g->y, g->width, g->height);
+            g->x = x;
+            g->y = y;
+            g->width = width;
+            g->height = height;
+            g->dirty = true;
+        }
+        return g;
+    }
+
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 8;
+        termui_group_t **groups = realloc(list->groups, (size_t)capacity * sizeof(termui_group_t *));
+        if (!groups) {
+            return NULL;
+        }
+        list->groups = groups;
+        list->capacity = capacity;
+    }
+
+    termui_group_t *g = calloc(1, sizeof(termui_group_t));
+    if (!g) {
+        return NULL;
+    }
+    size_t len = strlen(name);
+    g->name = malloc(len + 1);
+    if (!g->name) {
+        free(g);
+        return NULL;
+    }
+    memcpy(g->name, name, len + 1);
+    g->x = x;
+    g->y = y;
+    g->width = width;
+    g->height = height;
+
+    list->groups[list->count++] = g;
+    return g;
+}
+
+void termui_display_list_remove(termui_display_list_t *list, termui_group_t *group) {
+    if (!list || !group) return;
+
+    int index = -1;
+    for (int i = 0; i < list->count; i++) {
+        if (list->groups[i] == group) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) return;
+
+    memmove(&list->groups[index], &list->groups[index + 1],
+            (size_t)(list->count - index - 1) * sizeof(termui_group_t *));
+    list->count--;
+
+    damage_groups(list, group->x, group->y, group->width, group->height);
+    clear_rect(list->target, group->x, group->y, group->width, group->height);
+    group_free(group);
+}
+
+void termui_display_list_invalidate(termui_display_list_t *list) {
+    if (!list) return;
+
+    for (int i = 0; i < list->count; i++) {
+        list->groups[i]->dirty = true;
+    }
+}
+
+bool termui_group_begin(termui_group_t *group, uint64_t key) {
+    if (!group) return false;
+
+    if (group->recorded && group->key == key) {
+        group->recording = false;
+        return false;
+    }
+
+    group->key = key;
+    group->recorded = true;
+    group->recording = true;
+    group->dirty = true;
+    group->count = 0;
+    group->pool_len = 0;
+    return true;
+}
+
+/* Append a command; NULL when not recording or out of memory */
+static draw_cmd_t* record(termui_group_t *g, cmd_type_t type, int x, int y) {
+    if (!g || !g->recording) {
+        return NULL;
+    }
+
+    if (g->count == g->capacity) {
+        int capacity = g->capacity ? g->capacity * 2 : 16;
+        draw_cmd_t *cmds = realloc(g->cmds, (size_t)capacity * sizeof(draw_cmd_t));
+        if (!cmds) {
+            return NULL;
+        }
+        g->cmds = cmds;
+        g->capacity = capacity;
+    }
+
+    draw_cmd_t *cmd = &g->cmds[g->count++];
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->type = type;
+    cmd->x = x;
+    cmd->y = y;
+    return cmd;
+}
+
+/* Copy at most max bytes of text into the pool, NUL-terminated;
+ * false (and the command dropped) if out of memory */
+static bool record_text(termui_group_t *g, draw_cmd_t *cmd, const char *str, size_t max) {
+    size_t len = 0;
+    while (len < max && str[len] != '\0') {
+        len++;
+    }
+    if (g->pool_len + len + 1 > g->pool_cap) {
+        size_t cap = g->pool_cap ? g->pool_cap : 256;
+        while (cap < g->pool_len + len + 1) {
+            cap *= 2;
+        }
+        char *pool = realloc(g->pool, cap);
+        if (!pool) {
+            g->count--;
+            return false;
+        }
+        g->pool = pool;
+        g->pool_cap = cap;
+    }
+
+    memcpy(g->pool + g->pool_len, str, len);
+    g->pool[g->pool_len + len] = '\0';
+    cmd->text = g->pool_len;
+    g->pool_len += len + 1;
+    return true;
+}
+
+void termui_group_draw_char(termui_group_t *group, int x, int y, char c, termui_color_t color) {
+    draw_cmd_t *cmd = record(group, CMD_CHAR, x, y);
+    if (cmd) {
+        cmd->value = (unsigned char)c;
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_string(termui_group_t *group, int x, int y, const char *str, termui_color_t color) {
+    if (!str) return;
+
+    draw_cmd_t *cmd = record(group, CMD_STRING, x, y);
+    if (cmd && record_text(group, cmd, str, SIZE_MAX)) {
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_text_n(termui_group_t *group, int x, int y, const char *str, size_t len,
+                              termui_color_t color) {
+    if (!str) return;
+
+    /* Replayed with draw_string: the pooled copy ends at len */
+    draw_cmd_t *cmd = record(group, CMD_STRING, x, y);
+    if (cmd && record_text(group, cmd, str, len)) {
+        cmd->color = color;
+    }
+}
+
+void termui_group_fill_rect(termui_group_t *group, int x, int y, int width, int height,
+                            char c, termui_color_t color) {
+    draw_cmd_t *cmd = record(group, CMD_FILL_RECT, x, y);
+    if (cmd) {
+        cmd->w = width;
+        cmd->h = height;
+        cmd->value = (unsigned char)c;
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_utf8(termui_group_t *group, int x, int y, const char *str, termui_color_t color) {
+    if (!str) return;
+
+    draw_cmd_t *cmd = record(group, CMD_UTF8, x, y);
+    if (cmd && record_text(group, cmd, str, SIZE_MAX)) {
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_styled(termui_group_t *group, int x, int y, const char *str,
+                              const termui_style_t *style) {
+    if (!str || !style) return;
+
+    draw_cmd_t *cmd = record(group, CMD_STYLED, x, y);
+    if (cmd && record_text(group, cmd, str, SIZE_MAX)) {
+        cmd->style = *style;
+    }
+}
+
+void termui_group_draw_codepoint(termui_group_t *group, int x, int y, uint32_t codepoint, termui_color_t color) {
+    draw_cmd_t *cmd = record(group, CMD_CODEPOINT, x, y);
+    if (cmd) {
+        cmd->value = codepoint;
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_hline(termui_group_t *group, int x, int y, int length, char c, termui_color_t color) {
+    draw_cmd_t *cmd = record(group, CMD_HLINE, x, y);
+    if (cmd) {
+        cmd->w = length;
+        cmd->value = (unsigned char)c;
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_vline(termui_group_t *group, int x, int y, int length, char c, termui_color_t color) {
+    draw_cmd_t *cmd = record(group, CMD_VLINE, x, y);
+    if (cmd) {
+        cmd->h = length;
+        cmd->value = (unsigned char)c;
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_box(termui_group_t *group, int x, int y, int width, int height, termui_color_t color) {
+    draw_cmd_t *cmd = record(group, CMD_BOX, x, y);
+    if (cmd) {
+        cmd->w = width;
+        cmd->h = height;
+        cmd->color = color;
+    }
+}
+
+void termui_group_draw_box_style(termui_group_t *group, int x, int y, int width, int height,
+                                 termui_box_style_t style, termui_color_t color) {
+    draw_cmd_t *cmd = record(group, CMD_BOX_STYLE, x, y);
+    if (cmd) {
+        cmd->w = width;
+        cmd->h = height;
+        cmd->box = style;
+        cmd->color = color;
+    }
+}
+
+void termui_group_set_style(termui_group_t *group, int x, int y, int width, int height,
+                            const termui_style_t *style) {
+    if (!style) return;
+
+    draw_cmd_t *cmd = record(group, CMD_SET_STYLE, x, y);
+    if (cmd) {
+        cmd->w = width;
+        cmd->h = height;
+        cmd->style = *style;
+    }
+}
+
+static void replay_cmd(termui_buffer_t *view, const termui_group_t *g, const draw_cmd_t *cmd) {
+    const char *text = g->pool + cmd->text;
+
+    switch (cmd->type) {
+        case CMD_CHAR:
+            termui_buffer_draw_char(view, cmd->x, cmd->y, (char)cmd->value, cmd->color);
+            break;
+        case CMD_STRING:
+            termui_buffer_draw_string(view, cmd->x, cmd->y, text, cmd->color);
+            break;
+        case CMD_FILL_RECT:
+            termui_buffer_fill_rect(view, cmd->x, cmd->y, cmd->w, cmd->h, (char)cmd->value, cmd->color);
+            break;
+        case CMD_UTF8:
+            termui_buffer_draw_utf8(view, cmd->x, cmd->y, text, cmd->color);
+            break;
+        case CMD_STYLED:
+            termui_buffer_draw_styled(view, cmd->x, cmd->y, text, &cmd->style);
+            break;
+        case CMD_CODEPOINT:
+            termui_buffer_draw_codepoint(view, cmd->x, cmd->y, cmd->value, cmd->color);
+            break;
+        case CMD_HLINE:
+            termui_buffer_draw_hline(view, cmd->x, cmd->y, cmd->w, (char)cmd->value, cmd->color);
+            break;
+        case CMD_VLINE:
+            termui_buffer_draw_vline(view, cmd->x, cmd->y, cmd->h, (char)cmd->value, cmd->color);
+            break;
+        case CMD_BOX:
+            termui_buffer_draw_box(view, cmd->x, cmd->y, cmd->w, cmd->h, cmd->color);
+            break;
+        case CMD_BOX_STYLE:
+            termui_buffer_draw_box_style(view, cmd->x, cmd->y, cmd->w, cmd->h, cmd->box, cmd->color);
+            break;
+        case CMD_SET_STYLE:
+            termui_buffer_set_style(view, cmd->x, cmd->y, cmd->w, cmd->h, &cmd->style);
+            break;
+    }
+}
+
+/* Clear the group's rectangle and draw its commands into it */
+static bool replay_group(termui_buffer_t *target, termui_group_t *g) {
+    int x0 = g->x < 0 ? 0 : g->x;
+    int y0 = g->y < 0 ? 0 : g->y;
+    int x1 = g->x + g->width > target->width ? target->width : g->x + g->width;
+    int y1 = g->y + g->height > target->height ? target->height : g->y + g->height;
+    if (x0 >= x1 || y0 >= y1) {
+        return true;  /* Entirely off the target */
+    }
+
+    termui_buffer_t *view = termui_buffer_view_create(target, x0, y0, x1 - x0, y1 - y0);
+    if (!view) {
+        return false;
+    }
+
+    termui_buffer_clear(view);
+    /* Commands are relative to the group origin, which may be clipped off */
+    int dx = g->x - x0;
+    int dy = g->y - y0;
+    for (int i = 0; i < g->count; i++) {
+        draw_cmd_t cmd = g->cmds[i];
+        cmd.x += dx;
+        cmd.y += dy;
+        replay_cmd(view, g, &cmd);
+    }
+
+    termui_buffer_view_commit(view, target, x0, y0);
+    termui_buffer_view_destroy(view);
+    return true;
+}
+
+int termui_display_list_replay(termui_display_list_t *list) {
+    if (!list) return 0;
+
+    int replayed = 0;
+    for (int i = 0; i < list->count; i++) {
+        termui_group_t *g = list->groups[i];
+        g->recording = false;
+        if (!g->dirty) continue;
+
+        if (!replay_group(list->target, g)) {
+            continue;  /* Out of memory: try again next time */
+        }
+        g->dirty = false;
+        replayed++;
+
+        /* Later groups drawn over this one must be redrawn on top */
+        for (int j = i + 1; j < list->count; j++) {
+            if (rects_overlap(list->groups[j], g->x, g->y, g->width, g->height)) {
+                list->groups[j]->dirty = true;
+            }
+        }
+    }
+    return replayed;
+}
@@ -0,0 +1,366 @@
+/*
+ * termui - Event Wait
+ *
+ * Blocks in poll() until stdin is readable, a wake byte arrives on the
+ * self-pipe, an app-watched fd is ready, a timer is due or the timeout
+ * expires. The SIGWINCH handler and termui_input_wake write to the
+ * self-pipe, so a resize or a wake from another thread ends the wait
+ * immediately instead of at the next guessed sleep interval.
+ *
+ * While rendered output is queued for a slow terminal, the output fd is
+ * polled too, and queued bytes (then any deferred frame) are pushed out
+ * as soon as it becomes writable.
+ */
+
+/* Enable POSIX poll, pipe flags and clock_gettime */
+#define _POSIX_C_SOURCE 200809L
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    int fd;                 /* -1 once unwatched */
+    int events;             /* TERMUI_FD_* */
+    termui_fd_fn callback;
+    void *user;
+    bool internal;          /* Ends a wait only by queueing input */
+} fd_watch_t;
+
+typedef struct {
+    int id;                 /* 0 once removed */
+    int64_t due;            /* Absolute monotonic ms */
+    int interval;           /* ms */
+    bool repeat;
+    termui_timer_fn callback;
+    void *user;
+} event_timer_t;
+
+/* Self-pipe: read end polled, write end written from signal handlers */
+static int g_wake[2] = {-1, -1};
+
+static fd_watch_t *g_watches = NULL;
+static int g_watch_count = 0;
+static int g_watch_capacity = 0;
+
+static event_timer_t *g_timers = NULL;
+static int g_timer_count = 0;
+static int g_timer_capacity = 0;
+static int g_next_timer_id = 1;
+
+/* Reused poll set */
+static struct pollfd *g_pollfds = NULL;
+static int g_pollfd_capacity = 0;
+
+/* Monotonic clock in milliseconds */
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool set_flags(int fd) {
+    int fl = fcntl(fd, F_GETFL);
+    int fd_fl = fcntl(fd, F_GETFD);
+    return fl >= 0 && fd_fl >= 0 &&
+           fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0 &&
+           fcntl(fd, F_SETFD, fd_fl | FD_CLOEXEC) == 0;
+}
+
+int termui_event_init(void) {
+    if (g_wake[0] >= 0) {
+        return TERMUI_OK;
+    }
+
+    if (pipe(g_wake) != 0) {
+        return TERMUI_ERROR;
+    }
+    if (!set_flags(g_wake[0]) || !set_flags(g_wake[1])) {
+        termui_event_cleanup();
+        return TERMUI_ERROR;
+    }
+    return TERMUI_OK;
+}
+
+void termui_event_cleanup(void) {
+    for (int i = 0; i < 2; i++) {
+        if (g_wake[i] >= 0) {
+            close(g_wake[i]);
+            g_wake[i] = -1;
+        }
+    }
+
+    free(g_watches);
+    g_watches = NULL;
+    g_watch_count = g_watch_capacity = 0;
+
+    free(g_timers);
+    g_timers = NULL;
+    g_timer_count = g_timer_capacity = 0;
+
+    free(g_pollfds);
+    g_pollfds = NULL;
+    g_pollfd_capacity = 0;
+}
+
+void termui_input_wake(void) {
+    /* Async-signal-safe: a full pipe already guarantees a wakeup */
+    int saved = errno;
+    if (g_wake[1] >= 0) {
+        ssize_t n = write(g_wake[1], "", 1);
+        (void)n;
+    }
+    errno = saved;
+}
+
+static void drain_wake(void) {
+    char scratch[64];
+    while (read(g_wake[0], scratch, sizeof(scratch)) > 0) {
+        /* Wakes coalesce */
+    }
+}
+
+static int watch_add(int fd, int events, termui_fd_fn callback, void *user, bool internal) {
+    if (fd < 0 || !callback || !(events & (TERMUI_FD_READ | TERMUI_FD_WRITE))) {
+        return TERMUI_INVALID;
+    }
+
+    /* Re-watching an fd replaces its entry */
+    for (int i = 0; i < g_watch_count; i++) {
+        if (g_watches[i].fd == fd) {
+            g_watches[i].events = events;
+            g_watches[i].callback = callback;
+            g_watches[i].user = user;
+            g_watches[i].internal = internal;
+            return TERMUI_OK;
+        }
+    }
+
+    if (g_watch_count == g_watch_capacity) {
+        int capacity = g_watch_capacity ? g_watch_capacity * 2 : 4;
+        fd_watch_t *watches = realloc(g_watches, (size_t)capacity * sizeof(fd_watch_t));
+        if (!watches) {
+            return TERMUI_NOMEM;
+        }
+        g_watches = watches;
+        g_watch_capacity = capacity;
+    }
+
+    g_watches[g_watch_count++] = (fd_watch_t){ fd, events, callback, user, internal };
+    return TERMUI_OK;
+}
+
+int termui_input_watch_fd(int fd, int events, termui_fd_fn callback, void *user) {
+    return watch_add(fd, events, callback, user, false);
+}
+
+int termui_event_watch_internal(int fd, termui_fd_fn callback, void *user) {
+    return watch_add(fd, TERMUI_FD_READ, callback, user, true);
+}
+
+void termui_input_unwatch_fd(int fd) {
+    /* Only marked here; compacted after dispatch so callbacks may unwatch */
+    for (int i = 0; i < g_watch_count; i++) {
+        if (g_watches[i].fd == fd) {
+            g_watches[i].fd = -1;
+        }
+    }
+}
+
+int termui_timer_add(int interval_ms, bool repeat, termui_timer_fn callback, void *user) {
+    if (interval_ms < 0 || !callback || (repeat && interval_ms == 0)) {
+        return TERMUI_INVALID;
+    }
+
+    if (g_timer_count == g_timer_capacity) {
+        int capacity = g_timer_capacity ? g_timer_capacity * 2 : 4;
+        event_timer_t *timers = realloc(g_timers, (size_t)capacity * sizeof(event_timer_t));
+        if (!timers) {
+            return TERMUI_NOMEM;
+        }
+        g_timers = timers;
+        g_timer_capacity = capacity;
+    }
+
+    int id = g_next_timer_id++;
+    if (g_next_timer_id <= 0) {
+        g_next_timer_id = 1;
+    }
+    g_timers[g_timer_count++] = (event_timer_t){
+        id, now_ms() + interval_ms, interval_ms, repeat, callback, user
+    };
+    return id;
+}
+
+void termui_timer_remove(int id) {
+    for (int i = 0; i < g_timer_count; i++) {
+        if (g_timers[i].id == id) {
+            g_timers[i].id = 0;
+        }
+    }
+}
+
+/* Drop unwatched fds and removed timers */
+static void compact(void) {
+    int n = 0;
+    for (int i = 0; i < g_watch_count; i++) {
+        if (g_watches[i].fd >= 0) g_watches[n++] = g_watches[i];
+    }
+    g_watch_count = n;
+
+    n = 0;
+    for (int i = 0; i < g_timer_count; i++) {
+        if (g_timers[i].id != 0) g_timers[n++] = g_timers[i];
+    }
+    g_timer_count = n;
+}
+
+/* Milliseconds until the earliest timer, or -1 if none */
+static int64_t next_timer_delay(int64_t now) {
+    int64_t delay = -1;
+    for (int i = 0; i < g_timer_count; i++) {
+        if (g_timers[i].id == 0) continue;
+        int64_t d = g_timers[i].due > now ? g_timers[i].due - now : 0;
+        if (delay < 0 || d < delay) delay = d;
+    }
+    return delay;
+}
+
+/* Run every timer that is due; returns the number fired */
+static int fire_timers(int64_t now) {
+    int fired = 0;
+
+    /* Timers added by a callback wait for the next round */
+    int count = g_timer_count;
+    for (int i = 0; i < count; i++) {
+        event_timer_t *t = &g_timers[i];
+        if (t->id == 0 || t->due > now) continue;
+
+        if (t->repeat) {
+            /* Keep the cadence, skipping periods that were missed */
+            t->due += t->interval;
+            if (t->due <= now) {
+                t->due = now + t->interval;
+            }
+        }
+        termui_timer_fn callback = t->callback;
+        void *user = t->user;
+        if (!t->repeat) {
+            t->id = 0;
+        }
+        /* t is not used again: a callback may grow (move) the table */
+        callback(user);
+        fired++;
+    }
+    return fired;
+}
+
+bool termui_event_wait(int input_fd, int timeout_ms) {
+    int64_t start = now_ms();
+
+    for (;;) {
+        int64_t now = now_ms();
+        if (fire_timers(now) > 0) {
+            compact();
+            return false;
+        }
+
+        /* Effective timeout: caller's deadline or the next timer */
+        int64_t wait = -1;
+        if (timeout_ms >= 0) {
+            wait = start + timeout_ms - now;
+            if (wait < 0) wait = 0;
+        }
+        int64_t timer = next_timer_delay(now);
+        if (timer >= 0 && (wait < 0 || timer < wait)) {
+            wait = timer;
+        }
+        if (wait > 0x7fffffff) wait = 0x7fffffff;
+
+        int needed = g_watch_count + 3;
+        if (needed > g_pollfd_capacity) {
+            struct pollfd *fds = realloc(g_pollfds, (size_t)needed * sizeof(struct pollfd));
+            if (!fds) {
+                return false;
+            }
+            g_pollfds = fds;
+            g_pollfd_capacity = needed;
+        }
+
+        int nfds = 0;
+        int input_slot = -1, wake_slot = -1, output_slot = -1;
+        int output_fd = termui_output_poll_fd();
+        if (input_fd >= 0) {
+            input_slot = nfds;
+            g_pollfds[nfds++] = (struct pollfd){ input_fd, POLLIN, 0 };
+        }
+        if (g_wake[0] >= 0) {
+            wake_slot = nfds;
+            g_pollfds[nfds++] = (struct pollfd){ g_wake[0], POLLIN, 0 };
+        }
+        if (output_fd >= 0) {
+            output_slot = nfds;
+            g_pollfds[nfds++] = (struct pollfd){ output_fd, POLLOUT, 0 };
+        }
+        int first_watch = nfds;
+        for (int i = 0; i < g_watch_count; i++) {
+            short events = 0;
+            if (g_watches[i].events & TERMUI_FD_READ) events |= POLLIN;
+            if (g_watches[i].events & TERMUI_FD_WRITE) events |= POLLOUT;
+            g_pollfds[nfds++] = (struct pollfd){ g_watches[i].fd, events, 0 };
+        }
+
+        int ready = poll(g_pollfds, (nfds_t)nfds, (int)wait);
+        if (ready < 0) {
+            return false;  /* EINTR: let the caller see what the signal flagged */
+        }
+
+        if (ready == 0) {
+            if (timeout_ms >= 0 && now_ms() - start >= timeout_ms) {
+                return false;
+            }
+            continue;  /* A timer is due */
+        }
+
+        if (output_slot >= 0 && g_pollfds[output_slot].revents) {
+            termui_output_service();  /* Not a wakeup: output is internal */
+        }
+
+        bool woken = false;
+        if (wake_slot >= 0 && g_pollfds[wake_slot].revents) {
+            drain_wake();
+            woken = true;
+        }
+
+        /* Dispatch watched fds; a callback may unwatch others */
+        int watch_count = g_watch_count;
+        for (int i = 0; i < watch_count && first_watch + i < nfds; i++) {
+            short revents = g_pollfds[first_watch + i].revents;
+            if (!revents || g_watches[i].fd < 0) continue;
+
+            int events = 0;
+            if (revents & (POLLIN | POLLHUP)) events |= TERMUI_FD_READ;
+            if (revents & POLLOUT) events |= TERMUI_FD_WRITE;
+            if (revents & (POLLERR | POLLNVAL)) events |= TERMUI_FD_ERROR;
+            g_watches[i].callback(g_watches[i].fd, events, g_watches[i].user);
+            /* A gamepad report that queued no action is not a wakeup */
+            if (!g_watches[i].internal || termui_input_queued()) {
+                woken = true;
+            }
+        }
+        compact();
+
+        if (input_slot >= 0 && g_pollfds[input_slot].revents) {
+            return true;
+        }
+        if (woken) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,505 @@
+/*
+ * termui - Gamepad Input
+ *
+ * Reads Linux evdev devices (/dev/input/event*) directly. Each read()
+ * drains up to a batch of events, axis values are normalized using the
+ * device's EVIOCGABS calibration with a deadzone, and button presses and
+ * stick/d-pad direction changes are queued as TERMUI_INPUT_* actions
+ * alongside the keyboard. Pad fds are watched by termui_input_wait, so a
+ * blocked wait wakes as soon as the controller reports an action; other
+ * reports (axis noise, releases) are read without ending it. Any fd
+ * carrying struct input_event records works, so a pipe can stand in for
+ * a device.
+ *
+ * Buttons are numbered like the rest of the organization's joystick
+ * code: the code's offset from BTN_GAMEPAD or BTN_JOYSTICK, 0-15.
+ */
+
+/* Enable POSIX open flags and clock ids */
+#define _POSIX_C_SOURCE 200809L
+
+#include "termui.h"
+#include "termui_internal.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Events read per syscall */
+#define EVENT_BATCH 64
+
+/* Default deadzone, percent of half travel */
+#define DEFAULT_DEADZONE 15
+
+/* Normalized stick position that starts / ends a direction action */
+#define DIR_PRESS   500
+#define DIR_RELEASE 250
+
+/* Devices scanned when no path is given */
+#define SCAN_DEVICES 64
+
+#define LONG_BITS (8 * sizeof(unsigned long))
+#define BITS_LONGS(n) (((n) + LONG_BITS - 1) / LONG_BITS)
+#define TEST_BIT(bits, n) (((bits)[(n) / LONG_BITS] >> ((n) % LONG_BITS)) & 1ul)
+
+/* Axes tracked, indexed by slot */
+enum { AXIS_X, AXIS_Y, AXIS_RX, AXIS_RY, AXIS_HAT_X, AXIS_HAT_Y, AXIS_COUNT };
+
+static const int g_axis_codes[AXIS_COUNT] = {
+    ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_HAT0X, ABS_HAT0Y
+};
+
+typedef struct {
+    bool present;
+    int center;
+    int half;               /* Half of the calibrated range */
+    int deadzone;           /* Raw units around center reported as 0 */
+    int raw;
+} axis_t;
+
+struct termui_gamepad {
+    int fd;
+    bool joystick;          /* Buttons are BTN_JOYSTICK based, not BTN_GAMEPAD */
+    bool dropped;           /* Kernel queue overflowed; resync at SYN_REPORT */
+    int deadzone_percent;
+    axis_t axes[AXIS_COUNT];
+    uint16_t buttons;
+    int dir_x, dir_y;       /* Direction currently reported: -1, 0, 1 */
+    termui_gamepad_t *next;
+};
+
+static termui_gamepad_t *g_pads = NULL;
+
+/* Deadzone in raw units: the driver's flat zone or the configured share */
+static void axis_calibrate(axis_t *a, int flat, int percent) {
+    int dz = (int)((long)a->half * percent / 100);
+    a->deadzone = flat > dz ? flat : dz;
+    if (a->deadzone >= a->half) {
+        a->deadzone = a->half - 1;
+    }
+}
+
+static bool axis_load(termui_gamepad_t *pad, int slot) {
+    struct input_absinfo info;
+    axis_t *a = &pad->axes[slot];
+
+    if (ioctl(pad->fd, EVIOCGABS(g_axis_codes[slot]), &info) != 0) {
+        return false;
+    }
+    a->center = (int)(((long)info.minimum + info.maximum) / 2);
+    a->half = (int)(((long)info.maximum - info.minimum) / 2);
+    if (a->half < 1) {
+        a->half = 1;
+    }
+    a->raw = info.value;
+    axis_calibrate(a, info.flat, pad->deadzone_percent);
+    return true;
+}
+
+/* Axis position in -1000..1000 with the deadzone removed */
+static int axis_value(const axis_t *a) {
+    if (!a->present) {
+        return 0;
+    }
+
+    int v = a->raw - a->center;
+    int mag = v < 0 ? -v : v;
+    if (mag <= a->deadzone) {
+        return 0;
+    }
+
+    long scaled = (long)(mag - a->deadzone) * 1000 / (a->half - a->deadzone);
+    if (scaled > 1000) scaled = 1000;
+    return v < 0 ? -(int)scaled : (int)scaled;
+}
+
+/* D-pad axis as -1, 0 or 1 */
+static int hat_value(const axis_t *a) {
+    if (!a->present || a->raw == a->center) {
+        return 0;
+    }
+    return a->raw < a->center ? -1 : 1;
+}
+
+/* Button index 0-15 for an EV_KEY code, or -1 */
+static int button_index(int code) {
+    if (code >= BTN_GAMEPAD && code < BTN_GAMEPAD + 16) return code - BTN_GAMEPAD;
+    if (code >= BTN_JOYSTICK && code < BTN_JOYSTICK + 16) return code - BTN_JOYSTICK;
+    return -1;
+}
+
+/* Action for a pressed button */
+static termui_input_t button_action(const termui_gamepad_t *pad, int index) {
+    if (pad->joystick) {
+        /* Trigger, thumb, top..., base - the generic USB pad layout */
+        switch (index) {
+            case 0: case 9: return TERMUI_INPUT_ACTION;
+            case 1: case 8: return TERMUI_INPUT_CANCEL;
+            case 4: case 6: return TERMUI_INPUT_ZOOM_OUT;
+            case 5: case 7: return TERMUI_INPUT_ZOOM_IN;
+            default:        return TERMUI_INPUT_NONE;
+        }
+    }
+
+    switch (index + BTN_GAMEPAD) {
+        case BTN_SOUTH: case BTN_START:  return TERMUI_INPUT_ACTION;
+        case BTN_EAST:  case BTN_SELECT: return TERMUI_INPUT_CANCEL;
+        case BTN_TL:    case BTN_TL2:    return TERMUI_INPUT_ZOOM_OUT;
+        case BTN_TR:    case BTN_TR2:    return TERMUI_INPUT_ZOOM_IN;
+        default:                         return TERMUI_INPUT_NONE;
+    }
+}
+
+/* Direction from the d-pad, else the left stick, with hysteresis */
+static int direction(int hat, int stick, int current) {
+    if (hat != 0) {
+        return hat;
+    }
+    if (stick <= -DIR_PRESS) return -1;
+    if (stick >= DIR_PRESS) return 1;
+    if (current < 0 && stick <= -DIR_RELEASE) return -1;
+    if (current > 0 && stick >= DIR_RELEASE) return 1;
+    return 0;
+}
+
+static uint64_t event_ns(const struct input_event *ev) {
+    return (uint64_t)ev->input_event_sec * 1000000000u + (uint64_t)ev->input_event_usec * 1000u;
+}
+
+/* After a frame (SYN_REPORT): queue direction changes */
+static void frame_end(termui_gamepad_t *pad, uint64_t time_ns) {
+    int dx = direction(hat_value(&pad->axes[AXIS_HAT_X]), axis_value(&pad->axes[AXIS_X]), pad->dir_x);
+    int dy = direction(hat_value(&pad->axes[AXIS_HAT_Y]), axis_value(&pad->axes[AXIS_Y]), pad->dir_y);
+
+    if (dx != pad->dir_x && dx != 0) {
+        termui_input_push(dx < 0 ? TERMUI_INPUT_LEFT : TERMUI_INPUT_RIGHT, time_ns);
+    }
+    if (dy != pad->dir_y && dy != 0) {
+        termui_input_push(dy < 0 ? TERMUI_INPUT_UP : TERMUI_INPUT_DOWN, time_ns);
+    }
+    pad->dir_x = dx;
+    pad->dir_y = dy;
+}
+
+/* Load held buttons from the device */
+static void load_buttons(termui_gamepad_t *pad) {
+    unsigned long keys[BITS_LONGS(KEY_CNT)];
+    memset(keys, 0, sizeof(keys));
+    if (ioctl(pad->fd, EVIOCGKEY(sizeof(keys)), keys) >= 0) {
+        int base = pad->joystick ? BTN_JOYSTICK : BTN_GAMEPAD;
+        pad->buttons = 0;
+        for (int i = 0; i < 16; i++) {
+            if (TEST_BIT(keys, (unsigned long)(base + i))) {
+                pad->buttons |= (uint16_t)(1u << i);
+            }
+        }
+    }
+}
+
+/* Reload axes and buttons after the kernel dropped events */
+static void resync(termui_gamepad_t *pad) {
+    for (int i = 0; i < AXIS_COUNT; i++) {
+        if (pad->axes[i].present) {
+            axis_load(pad, i);
+        }
+    }
+    load_buttons(pad);
+}
+
+static void handle_event(termui_gamepad_t *pad, const struct input_event *ev) {
+    if (ev->type == EV_SYN) {
+        if (ev->code == SYN_DROPPED) {
+            pad->dropped = true;
+        } else if (ev->code == SYN_REPORT) {
+            if (pad->dropped) {
+                resync(pad);
+                pad->dropped = false;
+            }
+            frame_end(pad, event_ns(ev));
+        }
+        return;
+    }
+    if (pad->dropped) {
+        return;  /* Partial frame - state is reloaded at SYN_REPORT */
+    }
+
+    if (ev->type == EV_ABS) {
+        for (int i = 0; i < AXIS_COUNT; i++) {
+            if (g_axis_codes[i] == ev->code) {
+                pad->axes[i].raw = ev->value;
+                break;
+            }
+        }
+    } else if (ev->type == EV_KEY) {
+        int index = button_index(ev->code);
+        if (index < 0) {
+            return;
+        }
+        if (ev->value == 0) {
+            pad->buttons &= (uint16_t)~(1u << index);
+        } else if (ev->value == 1) {
+            /* Press only - value 2 is kernel autorepeat */
+            pad->buttons |= (uint16_t)(1u << index);
+            termui_input_t action = button_action(pad, index);
+            if (action != TERMUI_INPUT_NONE) {
+                termui_input_push(action, event_ns(ev));
+            }
+        }
+    }
+}
+
+static void pad_disconnect(termui_gamepad_t *pad) {
+    if (pad->fd >= 0) {
+        termui_input_unwatch_fd(pad->fd);
+        close(pad->fd);
+        pad->fd = -1;
+    }
+    pad->buttons = 0;
+    pad->dir_x = pad->dir_y = 0;
+    for (int i = 0; i < AXIS_COUNT; i++) {
+        pad->axes[i].raw = pad->axes[i].center;
+    }
+}
+
+/* Read everything the device has queued, a batch per syscall */
+static void pad_read(termui_gamepad_t *pad) {
+    struct input_event evs[EVENT_BATCH];
+
+    while (pad->fd >= 0) {
+        ssize_t n = read(pad->fd, evs, sizeof(evs));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                pad_disconnect(pad);  /* ENODEV: unplugged */
+            }
+            return;
+        }
+        if (n == 0) {
+            return;
+        }
+
+        size_t count = (size_t)n / sizeof(struct input_event);
+        for (size_t i = 0; i < count; i++) {
+            handle_event(pad, &evs[i]);
+        }
+        if (count < EVENT_BATCH) {
+            return;  /* Short read - queue is empty */
+        }
+    }
+}
+
+static void pad_ready(int fd, int events, void *user) {
+    (void)fd;
+    (void)events;
+    pad_read(user);
+}
+
+/* Open path and check it reports buttons or axes */
+static int open_device(const char *path, bool require_gamepad, bool *joystick) {
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    unsigned long keys[BITS_LONGS(KEY_CNT)];
+    unsigned long abs[BITS_LONGS(ABS_CNT)];
+    memset(keys, 0, sizeof(keys));
+    memset(abs, 0, sizeof(abs));
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0 ||
+        ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs)), abs) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    bool gamepad_buttons = TEST_BIT(keys, (unsigned long)BTN_GAMEPAD) != 0;
+    bool joystick_buttons = TEST_BIT(keys, (unsigned long)BTN_JOYSTICK) != 0;
+    bool stick = TEST_BIT(abs, (unsigned long)ABS_X) && TEST_BIT(abs, (unsigned long)ABS_Y);
+
+    if (require_gamepad && !(stick && (gamepad_buttons || joystick_buttons))) {
+        close(fd);
+        return -1;
+    }
+
+    *joystick = joystick_buttons && !gamepad_buttons;
+    return fd;
+}
+
+/* Wrap an open, non-blocking fd in a pad and start watching it
+ * Returns NULL, leaving fd open, on failure */
+static termui_gamepad_t* pad_create(int fd, bool joystick) {
+    termui_gamepad_t *pad = calloc(1, sizeof(termui_gamepad_t));
+    if (!pad) {
+        return NULL;
+    }
+    pad->fd = fd;
+    pad->joystick = joystick;
+    pad->deadzone_percent = DEFAULT_DEADZONE;
+
+    /* Timestamps on the same clock as keyboard events */
+    int clock = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clock);
+
+    for (int i = 0; i < AXIS_COUNT; i++) {
+        pad->axes[i].present = axis_load(pad, i);
+    }
+    load_buttons(pad);
+    pad->dir_x = direction(0, axis_value(&pad->axes[AXIS_X]), 0);
+    pad->dir_y = direction(0, axis_value(&pad->axes[AXIS_Y]), 0);
+
+    if (termui_event_watch_internal(fd, pad_ready, pad) != TERMUI_OK) {
+        free(pad);
+        return NULL;
+    }
+
+    pad->next = g_pads;
+    g_pads = pad;
+    return pad;
+}
+
+termui_gamepad_t* termui_gamepad_open(const char *path) {
+    if (!termui_is_initialized()) {
+        return NULL;
+    }
+
+    int fd = -1;
+    bool joystick = false;
+    if (path) {
+        fd = open_device(path, false, &joystick);
+    } else {
+        char scan[32];
+        for (int i = 0; i < SCAN_DEVICES && fd < 0; i++) {
+            snprintf(scan, sizeof(scan), "/dev/input/event%d", i);
+            fd = open_device(scan, true, &joystick);
+        }
+    }
+    if (fd < 0) {
+        return NULL;
+    }
+
+    termui_gamepad_t *pad = pad_create(fd, joystick);
+    if (!pad) {
+        close(fd);
+    }
+    return pad;
+}
+
+termui_gamepad_t* termui_gamepad_open_fd(int fd) {
+    if (!termui_is_initialized() || fd < 0) {
+        return NULL;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return NULL;
+    }
+
+    /* Not an evdev device (a pipe): gamepad button layout, no axes */
+    unsigned long keys[BITS_LONGS(KEY_CNT)];
+    memset(keys, 0, sizeof(keys));
+    bool joystick = false;
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) >= 0) {
+        joystick = TEST_BIT(keys, (unsigned long)BTN_JOYSTICK) &&
+                   !TEST_BIT(keys, (unsigned long)BTN_GAMEPAD);
+    }
+    return pad_create(fd, joystick);
+}
+
+void termui_gamepad_close(termui_gamepad_t *pad) {
+    if (!pad) return;
+
+    for (termui_gamepad_t **p = &g_pads; *p; p = &(*p)->next) {
+        if (*p == pad) {
+            *p = pad->next;
+            break;
+        }
+    }
+    pad_disconnect(pad);
+    free(pad);
+}
+
+void termui_gamepad_set_deadzone(termui_gamepad_t *pad, int percent) {
+    if (!pad) return;
+
+    if (percent < 0) percent = 0;
+    if (percent > 99) percent = 99;
+    pad->deadzone_percent = percent;
+    for (int i = 0; i < AXIS_COUNT; i++) {
+        if (pad->axes[i].present && pad->fd >= 0) {
+            axis_load(pad, i);
+        }
+    }
+}
+
+void termui_gamepad_get_state(const termui_gamepad_t *pad, termui_gamepad_state_t *state) {
+    if (!state) return;
+
+    memset(state, 0, sizeof(*state));
+    if (!pad) return;
+
+    state->connected = pad->fd >= 0;
+    state->axis_x = axis_value(&pad->axes[AXIS_X]);
+    state->axis_y = axis_value(&pad->axes[AXIS_Y]);
+    state->axis_rx = axis_value(&pad->axes[AXIS_RX]);
+    state->axis_ry = axis_value(&pad->axes[AXIS_RY]);
+    state->hat_x = hat_value(&pad->axes[AXIS_HAT_X]);
+    state->hat_y = hat_value(&pad->axes[AXIS_HAT_Y]);
+    state->buttons = pad->buttons;
+}
+
+void termui_gamepad_pump(void) {
+    for (termui_gamepad_t *pad = g_pads; pad; pad = pad->next) {
+        pad_read(pad);
+    }
+}
+
+void termui_gamepad_disconnect_all(void) {
+    /* The app still holds the handles and frees them with
+     * termui_gamepad_close, so only the devices are released here */
+    for (termui_gamepad_t *pad = g_pads; pad; pad = pad->next) {
+        pad_disconnect(pad);
+    }
+}
+
+#else /* !__linux__ */
+
+termui_gamepad_t* termui_gamepad_open(const char *path) {
+    (void)path;
+    return NULL;  /* evdev is Linux-only */
+}
+
+termui_gamepad_t* termui_gamepad_open_fd(int fd) {
+    (void)fd;
+    return NULL;
+}
+
+void termui_gamepad_close(termui_gamepad_t *pad) {
+    (void)pad;
+}
+
+void termui_gamepad_set_deadzone(termui_gamepad_t *pad, int percent) {
+    (void)pad;
+    (void)percent;
+}
+
+void termui_gamepad_get_state(const termui_gamepad_t *pad, termui_gamepad_state_t *state) {
+    (void)pad;
+    if (state) {
+        *state = (termui_gamepad_state_t){0};
+    }
+}
+
+void termui_gamepad_pump(void) {
+}
+
+void termui_gamepad_disconnect_all(void) {
+}
+
+#endif /* __linux__ */
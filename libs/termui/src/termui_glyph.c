@@ -0,0 +1,382 @@
+/*
+ * termui - Glyph Table
+ *
+ * Cells store a 16-bit glyph id. ASCII is stored as-is; anything else is
+ * interned once into a global table holding its UTF-8 bytes and display
+ * width, so drawing and rendering never re-encode or re-measure text.
+ *
+ * Several threads may draw at once (see termui_tile.c): interning takes a
+ * mutex, while lookups by id stay lock-free. Entries live in fixed pages
+ * that never move, and the entry count is published with release order
+ * after an entry is complete.
+ *
+ * Display widths come from a 2-bit-per-codepoint table covering planes
+ * 0 and 1, expanded once from the range lists below. It does not depend
+ * on the process locale and the draw path never calls wcwidth.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest cluster (base plus combining marks) a glyph can hold */
+#define GLYPH_MAX_BYTES 11
+
+/* Codepoints covered by the width table */
+#define WIDTH_TABLE_LIMIT 0x20000u
+
+/* Interned glyph */
+typedef struct {
+    char bytes[GLYPH_MAX_BYTES];
+    unsigned char len;
+    unsigned char width;
+    uint32_t codepoint;     /* First codepoint of the cluster */
+} glyph_entry_t;
+
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} width_range_t;
+
+/* Zero-width: combining marks, joiners, variation selectors */
+static const width_range_t g_zero_ranges[] = {
+    {0x0300, 0x036f}, {0x0483, 0x0489}, {0x0591, 0x05bd}, {0x05bf, 0x05bf},
+    {0x05c1, 0x05c2}, {0x05c4, 0x05c5}, {0x05c7, 0x05c7}, {0x0610, 0x061a},
+    {0x064b, 0x065f}, {0x0670, 0x0670}, {0x06d6, 0x06dc}, {0x06df, 0x06e4},
+    {0x06e7, 0x06e8}, {0x06ea, 0x06ed}, {0x0711, 0x0711}, {0x0730, 0x074a},
+    {0x0900, 0x0902}, {0x093a, 0x093a}, {0x093c, 0x093c}, {0x0941, 0x0948},
+    {0x094d, 0x094d}, {0x0951, 0x0957}, {0x0e31, 0x0e31}, {0x0e34, 0x0e3a},
+    {0x0e47, 0x0e4e}, {0x1ab0, 0x1aff}, {0x1dc0, 0x1dff}, {0x200b, 0x200f},
+    {0x202a, 0x202e}, {0x2060, 0x2064}, {0x20d0, 0x20ff}, {0xfe00, 0xfe0f},
+    {0xfe20, 0xfe2f}, {0xfeff, 0xfeff}, {0x1f3fb, 0x1f3ff}
+};
+
+/* Double-width: East Asian Wide/Fullwidth and emoji presentation */
+static const width_range_t g_wide_ranges[] = {
+    {0x1100, 0x115f}, {0x231a, 0x231b}, {0x2329, 0x232a}, {0x23e9, 0x23ec},
+    {0x23f0, 0x23f0}, {0x23f3, 0x23f3}, {0x25fd, 0x25fe}, {0x2614, 0x2615},
+    {0x2648, 0x2653}, {0x267f, 0x267f}, {0x2693, 0x2693}, {0x26a1, 0x26a1},
+    {0x26aa, 0x26ab}, {0x26bd, 0x26be}, {0x26c4, 0x26c5}, {0x26ce, 0x26ce},
+    {0x26d4, 0x26d4}, {0x26ea, 0x26ea}, {0x26f2, 0x26f3}, {0x26f5, 0x26f5},
+    {0x26fa, 0x26fa}, {0x26fd, 0x26fd}, {0x2705, 0x2705}, {0x270a, 0x270b},
+    {0x2728, 0x2728}, {0x274c, 0x274c}, {0x274e, 0x274e}, {0x2753, 0x2755},
+    {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27b0, 0x27b0}, {0x27bf, 0x27bf},
+    {0x2b1b, 0x2b1c}, {0x2b50, 0x2b50}, {0x2b55, 0x2b55}, {0x2e80, 0x303e},
+    {0x3041, 0x33ff}, {0x3400, 0x4dbf}, {0x4e00, 0x9fff}, {0xa000, 0xa4cf},
+    {0xa960, 0xa97f}, {0xac00, 0xd7a3}, {0xf900, 0xfaff}, {0xfe10, 0xfe19},
+    {0xfe30, 0xfe6f}, {0xff00, 0xff60}, {0xffe0, 0xffe6}, {0x16fe0, 0x16fe4},
+    {0x17000, 0x18cff}, {0x1b000, 0x1b2ff}, {0x1f004, 0x1f004}, {0x1f0cf, 0x1f0cf},
+    {0x1f18e, 0x1f18e}, {0x1f191, 0x1f19a}, {0x1f200, 0x1f251}, {0x1f300, 0x1f320},
+    {0x1f32d, 0x1f335}, {0x1f337, 0x1f37c}, {0x1f37e, 0x1f393}, {0x1f3a0, 0x1f3ca},
+    {0x1f3cf, 0x1f3d3}, {0x1f3e0, 0x1f3f0}, {0x1f3f4, 0x1f3f4}, {0x1f3f8, 0x1f43e},
+    {0x1f440, 0x1f440}, {0x1f442, 0x1f4fc}, {0x1f4ff, 0x1f53d}, {0x1f54b, 0x1f54e},
+    {0x1f550, 0x1f567}, {0x1f57a, 0x1f57a}, {0x1f595, 0x1f596}, {0x1f5a4, 0x1f5a4},
+    {0x1f5fb, 0x1f64f}, {0x1f680, 0x1f6c5}, {0x1f6cc, 0x1f6cc}, {0x1f6d0, 0x1f6d2},
+    {0x1f6d5, 0x1f6d7}, {0x1f6eb, 0x1f6ec}, {0x1f6f4, 0x1f6fc}, {0x1f7e0, 0x1f7eb},
+    {0x1f90c, 0x1f93a}, {0x1f93c, 0x1f945}, {0x1f947, 0x1f9ff}, {0x1fa70, 0x1faff}
+};
+
+/* 2 bits per codepoint holding width ^ 1, so zero-filled means width 1 */
+static unsigned char g_width_bits[WIDTH_TABLE_LIMIT / 4];
+static bool g_width_ready = false;     /* Accessed atomically */
+static pthread_once_t g_width_once = PTHREAD_ONCE_INIT;
+
+/* Interned glyphs in pages; id = TERMUI_GLYPH_FIRST + index */
+#define GLYPH_PAGE_SIZE 256
+#define GLYPH_PAGES     ((TERMUI_GLYPH_LIMIT - TERMUI_GLYPH_FIRST + GLYPH_PAGE_SIZE - 1) / GLYPH_PAGE_SIZE)
+
+static glyph_entry_t *g_pages[GLYPH_PAGES];
+static size_t g_count = 0;              /* Accessed atomically */
+static pthread_mutex_t g_intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Open-addressed hash of entry indices (+1, 0 = empty) */
+static uint16_t *g_slots = NULL;
+static size_t g_slot_count = 0;
+
+static void width_set(uint32_t cp, int width) {
+    unsigned int shift = (cp & 3u) * 2u;
+    unsigned int code = (unsigned int)width ^ 1u;
+    g_width_bits[cp >> 2] = (unsigned char)((g_width_bits[cp >> 2] & ~(3u << shift)) |
+                                            (code << shift));
+}
+
+static void width_build(void) {
+    memset(g_width_bits, 0, sizeof(g_width_bits));
+    for (size_t i = 0; i < sizeof(g_zero_ranges) / sizeof(g_zero_ranges[0]); i++) {
+        for (uint32_t cp = g_zero_ranges[i].first; cp <= g_zero_ranges[i].last; cp++) {
+            width_set(cp, 0);
+        }
+    }
+    for (size_t i = 0; i < sizeof(g_wide_ranges) / sizeof(g_wide_ranges[0]); i++) {
+        for (uint32_t cp = g_wide_ranges[i].first; cp <= g_wide_ranges[i].last; cp++) {
+            width_set(cp, 2);
+        }
+    }
+    __atomic_store_n(&g_width_ready, true, __ATOMIC_RELEASE);
+}
+
+void termui_glyph_init(void) {
+    pthread_once(&g_width_once, width_build);
+}
+
+int termui_codepoint_width(uint32_t cp) {
+    if (cp < 0x7f) {
+        return 1;
+    }
+    if (cp >= WIDTH_TABLE_LIMIT) {
+        /* Planes 2 and 3 are CJK ideographs */
+        return cp < 0x40000 ? 2 : 1;
+    }
+    if (!__atomic_load_n(&g_width_ready, __ATOMIC_ACQUIRE)) {
+        termui_glyph_init();
+    }
+
+    unsigned int code = (g_width_bits[cp >> 2] >> ((cp & 3u) * 2u)) & 3u;
+    return (int)(code ^ 1u);
+}
+
+size_t termui_utf8_decode(const char *str, uint32_t *cp) {
+    const unsigned char *s = (const unsigned char *)str;
+    unsigned char c = s[0];
+
+    if (c < 0x80) {
+        *cp = c;
+        return 1;
+    }
+
+    size_t len;
+    uint32_t value;
+    uint32_t min;
+    if ((c & 0xe0) == 0xc0) {
+        len = 2; value = c & 0x1fu; min = 0x80;
+    } else if ((c & 0xf0) == 0xe0) {
+        len = 3; value = c & 0x0fu; min = 0x800;
+    } else if ((c & 0xf8) == 0xf0) {
+        len = 4; value = c & 0x07u; min = 0x10000;
+    } else {
+        *cp = 0xfffd;
+        return 1;
+    }
+
+    /* A NUL terminator fails the continuation check, so this never
+     * reads past the end of the string */
+    for (size_t i = 1; i < len; i++) {
+        if ((s[i] & 0xc0) != 0x80) {
+            *cp = 0xfffd;
+            return i;
+        }
+        value = (value << 6) | (s[i] & 0x3fu);
+    }
+
+    if (value < min || value > 0x10ffff || (value >= 0xd800 && value <= 0xdfff)) {
+        value = 0xfffd;
+    }
+    *cp = value;
+    return len;
+}
+
+static size_t utf8_encode(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xc0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xe0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+static size_t hash_bytes(const char *bytes, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)bytes[i]) * 16777619u;
+    }
+    return h;
+}
+
+static glyph_entry_t* entry(size_t index) {
+    return &g_pages[index / GLYPH_PAGE_SIZE][index % GLYPH_PAGE_SIZE];
+}
+
+/* Entry of a glyph id, or NULL if not interned */
+static const glyph_entry_t* lookup(unsigned int glyph) {
+    size_t index = glyph - TERMUI_GLYPH_FIRST;
+    if (glyph < TERMUI_GLYPH_FIRST || index >= __atomic_load_n(&g_count, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return entry(index);
+}
+
+static bool slots_grow(void) {
+    size_t count = g_slot_count ? g_slot_count * 2 : 256;
+    uint16_t *slots = calloc(count, sizeof(uint16_t));
+    if (!slots) {
+        return false;
+    }
+
+    for (size_t i = 0; i < g_count; i++) {
+        size_t s = hash_bytes(entry(i)->bytes, entry(i)->len) & (count - 1);
+        while (slots[s]) {
+            s = (s + 1) & (count - 1);
+        }
+        slots[s] = (uint16_t)(i + 1);
+    }
+
+    free(g_slots);
+    g_slots = slots;
+    g_slot_count = count;
+    return true;
+}
+
+/* Intern with the lock held */
+static unsigned int intern_locked(const char *bytes, size_t len, int width) {
+    if (g_slot_count) {
+        size_t s = hash_bytes(bytes, len) & (g_slot_count - 1);
+        while (g_slots[s]) {
+            const glyph_entry_t *e = entry(g_slots[s] - 1u);
+            if (e->len == len && memcmp(e->bytes, bytes, len) == 0) {
+                return TERMUI_GLYPH_FIRST + (unsigned int)(g_slots[s] - 1);
+            }
+            s = (s + 1) & (g_slot_count - 1);
+        }
+    }
+
+    /* New glyph */
+    if (g_count >= TERMUI_GLYPH_LIMIT - TERMUI_GLYPH_FIRST) {
+        return '?';  /* Table full */
+    }
+    if (g_count * 2 >= g_slot_count && !slots_grow()) {
+        return '?';
+    }
+    size_t page = g_count / GLYPH_PAGE_SIZE;
+    if (!g_pages[page]) {
+        g_pages[page] = malloc(GLYPH_PAGE_SIZE * sizeof(glyph_entry_t));
+        if (!g_pages[page]) {
+            return '?';
+        }
+    }
+
+    glyph_entry_t *e = entry(g_count);
+    memcpy(e->bytes, bytes, len);
+    e->len = (unsigned char)len;
+    e->width = (unsigned char)(width == 2 ? 2 : 1);
+    termui_utf8_decode(bytes, &e->codepoint);
+
+    size_t s = hash_bytes(bytes, len) & (g_slot_count - 1);
+    while (g_slots[s]) {
+        s = (s + 1) & (g_slot_count - 1);
+    }
+    g_slots[s] = (uint16_t)(g_count + 1);
+
+    /* Readers see the entry complete before they see the count */
+    __atomic_store_n(&g_count, g_count + 1, __ATOMIC_RELEASE);
+    return TERMUI_GLYPH_FIRST + (unsigned int)(g_count - 1);
+}
+
+unsigned int termui_glyph_intern(const char *bytes, size_t len, int width) {
+    if (len == 1 && (unsigned char)bytes[0] < 0x80) {
+        return (unsigned char)bytes[0];
+    }
+    if (len == 0 || len > GLYPH_MAX_BYTES) {
+        return '?';
+    }
+
+    pthread_mutex_lock(&g_intern_lock);
+    unsigned int glyph = intern_locked(bytes, len, width);
+    pthread_mutex_unlock(&g_intern_lock);
+    return glyph;
+}
+
+unsigned int termui_glyph_from_codepoint(uint32_t cp) {
+    if (cp < 0x80) {
+        return cp;
+    }
+
+    char bytes[4];
+    size_t len = utf8_encode(cp, bytes);
+    return termui_glyph_intern(bytes, len, termui_codepoint_width(cp));
+}
+
+const char* termui_glyph_bytes(unsigned int glyph, size_t *len) {
+    const glyph_entry_t *e = lookup(glyph);
+    if (!e) {
+        *len = 1;
+        return "?";
+    }
+    *len = e->len;
+    return e->bytes;
+}
+
+int termui_glyph_width(unsigned int glyph) {
+    if (glyph < TERMUI_GLYPH_FIRST) {
+        return 1;
+    }
+    if (glyph == TERMUI_GLYPH_CONT) {
+        return 0;
+    }
+
+    const glyph_entry_t *e = lookup(glyph);
+    return e ? e->width : 1;
+}
+
+uint32_t termui_glyph_codepoint(unsigned int glyph) {
+    if (glyph < TERMUI_GLYPH_FIRST) {
+        return glyph;
+    }
+
+    const glyph_entry_t *e = lookup(glyph);
+    return e ? e->codepoint : 0xfffd;
+}
+
+size_t termui_utf8_next_glyph(const char *str, unsigned int *glyph, int *width) {
+    uint32_t cp;
+    size_t len = termui_utf8_decode(str, &cp);
+
+    if (cp < 0x80) {
+        /* Control characters never reach the terminal */
+        *glyph = cp < 0x20 || cp == 0x7f ? '?' : cp;
+        *width = 1;
+        return len;
+    }
+
+    int w = termui_codepoint_width(cp);
+    if (cp < 0xa0 || w == 0) {
+        /* C1 control or stray combining mark */
+        *glyph = '?';
+        *width = 1;
+        return len;
+    }
+
+    /* Fold following combining marks into the same cluster */
+    size_t end = len;
+    for (;;) {
+        uint32_t next;
+        size_t n = termui_utf8_decode(str + end, &next);
+        if (next < 0x300 || termui_codepoint_width(next) != 0 || end + n > GLYPH_MAX_BYTES) {
+            break;
+        }
+        end += n;
+    }
+
+    if (end == len) {
+        *glyph = termui_glyph_from_codepoint(cp);
+    } else {
+        *glyph = termui_glyph_intern(str, end, w);
+    }
+    *width = termui_glyph_width(*glyph);  /* 1 if the table was full */
+    return end;
+}
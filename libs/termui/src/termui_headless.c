@@ -0,0 +1,526 @@
+/*
+ * termui - Headless Backend
+ *
+ * Runs termui without a tty. Frames go through the ANSI encoder as usual,
+ * but instead of being written to a terminal the bytes are fed to a small
+ * in-memory terminal model that understands everything the encoder emits:
+ * absolute and relative cursor moves, CR/LF, SGR colors (basic, 256 and
+ * 24-bit) and attributes, clears, scroll regions with SU/SD and UTF-8
+ * text. Resizing keeps the contents as xterm's alternate screen does.
+ * Tests read the resulting cell grid back, and the byte and
+ * escape-sequence counters show exactly what a real terminal would have
+ * been sent.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_WIDTH  80
+#define DEFAULT_HEIGHT 24
+#define MAX_PARAMS     16
+
+/* One screen cell; codepoint 0 is the right half of a wide glyph */
+typedef struct {
+    uint32_t codepoint;
+    termui_style_t style;
+} vt_cell_t;
+
+typedef enum {
+    VT_GROUND,
+    VT_ESCAPE,
+    VT_CSI
+} vt_state_t;
+
+/* Screen model */
+static vt_cell_t *g_cells = NULL;
+static int g_width = 0;
+static int g_height = 0;
+static int g_cur_x = 0;
+static int g_cur_y = 0;
+static termui_style_t g_pen;
+static int g_top = 0;               /* Scroll region, inclusive */
+static int g_bottom = 0;
+
+/* Parser */
+static vt_state_t g_state = VT_GROUND;
+static int g_params[MAX_PARAMS];
+static int g_param_count = 0;
+static bool g_private = false;      /* CSI ? ... */
+static unsigned char g_utf8[4];
+static size_t g_utf8_len = 0;
+static size_t g_utf8_need = 0;
+
+static termui_headless_stats_t g_stats;
+static long g_accept = -1;          /* Output still accepted, -1 for all */
+
+static void clear_cells(vt_cell_t *cells, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        cells[i].codepoint = ' ';
+        memset(&cells[i].style, 0, sizeof(cells[i].style));
+    }
+}
+
+static bool alloc_screen(int width, int height) {
+    vt_cell_t *cells = malloc((size_t)width * (size_t)height * sizeof(vt_cell_t));
+    if (!cells) {
+        return false;
+    }
+    clear_cells(cells, (size_t)width * (size_t)height);
+
+    free(g_cells);
+    g_cells = cells;
+    g_width = width;
+    g_height = height;
+    g_cur_x = g_cur_y = 0;
+    g_top = 0;
+    g_bottom = height - 1;
+    return true;
+}
+
+/* Resize keeping the top-left cells; shrinking past the cursor row
+ * scrolls the contents up to keep the cursor on screen */
+static bool resize_screen(int width, int height) {
+    vt_cell_t *cells = malloc((size_t)width * (size_t)height * sizeof(vt_cell_t));
+    if (!cells) {
+        return false;
+    }
+    clear_cells(cells, (size_t)width * (size_t)height);
+
+    int shift = g_cur_y >= height ? g_cur_y - height + 1 : 0;
+    int keep_w = width < g_width ? width : g_width;
+    for (int y = 0; y < height && y + shift < g_height; y++) {
+        memcpy(cells + (size_t)y * (size_t)width, g_cells + (size_t)(y + shift) * (size_t)g_width,
+               (size_t)keep_w * sizeof(vt_cell_t));
+    }
+
+    free(g_cells);
+    g_cells = cells;
+    g_width = width;
+    g_height = height;
+    g_cur_y -= shift;
+    if (g_cur_x >= width) g_cur_x = width - 1;
+    g_top = 0;
+    g_bottom = height - 1;
+    return true;
+}
+
+int termui_headless_init(int width, int height) {
+    if (width <= 0) width = DEFAULT_WIDTH;
+    if (height <= 0) height = DEFAULT_HEIGHT;
+
+    if (!alloc_screen(width, height)) {
+        return TERMUI_NOMEM;
+    }
+    memset(&g_pen, 0, sizeof(g_pen));
+    g_state = VT_GROUND;
+    g_utf8_len = g_utf8_need = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_accept = -1;
+    return TERMUI_OK;
+}
+
+void termui_headless_cleanup(void) {
+    free(g_cells);
+    g_cells = NULL;
+    g_width = g_height = 0;
+    g_accept = -1;
+}
+
+void termui_headless_get_size(int *width, int *height) {
+    if (width) *width = g_width;
+    if (height) *height = g_height;
+}
+
+/* Scroll rows [g_top, g_bottom] up by n lines (down if negative) */
+static void scroll_region(int n) {
+    int rows = g_bottom - g_top + 1;
+    int shift = n > 0 ? n : -n;
+    if (shift > rows) shift = rows;
+
+    size_t stride = (size_t)g_width;
+    vt_cell_t *region = g_cells + (size_t)g_top * stride;
+    size_t kept = (size_t)(rows - shift) * stride;
+    if (n > 0) {
+        memmove(region, region + (size_t)shift * stride, kept * sizeof(vt_cell_t));
+        clear_cells(region + kept, (size_t)shift * stride);
+    } else {
+        memmove(region + (size_t)shift * stride, region, kept * sizeof(vt_cell_t));
+        clear_cells(region, (size_t)shift * stride);
+    }
+}
+
+static int param(int i, int fallback) {
+    return i < g_param_count && g_params[i] > 0 ? g_params[i] : fallback;
+}
+
+/* Extended color after 38 or 48 (";5;n" or ";2;r;g;b") starting at
+ * params[*i]; returns false if malformed */
+static bool sgr_extended(int *i, termui_xcolor_t *color) {
+    int k = *i;
+    if (k + 1 < g_param_count && g_params[k + 1] == 5 && k + 2 < g_param_count) {
+        *color = TERMUI_XCOLOR_INDEX(g_params[k + 2]);
+        *i = k + 2;
+        return true;
+    }
+    if (k + 1 < g_param_count && g_params[k + 1] == 2 && k + 4 < g_param_count) {
+        *color = TERMUI_XCOLOR_RGB(g_params[k + 2], g_params[k + 3], g_params[k + 4]);
+        *i = k + 4;
+        return true;
+    }
+    return false;
+}
+
+static void apply_sgr(void) {
+    if (g_param_count == 0) {
+        memset(&g_pen, 0, sizeof(g_pen));
+        return;
+    }
+
+    for (int i = 0; i < g_param_count; i++) {
+        int p = g_params[i];
+        if (p == 0) {
+            memset(&g_pen, 0, sizeof(g_pen));
+        } else if (p == 1) {
+            g_pen.attrs |= TERMUI_ATTR_BOLD;
+        } else if (p == 4) {
+            g_pen.attrs |= TERMUI_ATTR_UNDERLINE;
+        } else if (p == 7) {
+            g_pen.attrs |= TERMUI_ATTR_REVERSE;
+        } else if (p == 22) {
+            g_pen.attrs &= ~(unsigned int)TERMUI_ATTR_BOLD;
+        } else if (p == 24) {
+            g_pen.attrs &= ~(unsigned int)TERMUI_ATTR_UNDERLINE;
+        } else if (p == 27) {
+            g_pen.attrs &= ~(unsigned int)TERMUI_ATTR_REVERSE;
+        } else if (p >= 30 && p <= 37) {
+            g_pen.fg = TERMUI_XCOLOR_INDEX(p - 30);
+        } else if (p >= 90 && p <= 97) {
+            g_pen.fg = TERMUI_XCOLOR_INDEX(p - 90 + 8);
+        } else if (p == 39) {
+            g_pen.fg = TERMUI_XCOLOR_DEFAULT;
+        } else if (p >= 40 && p <= 47) {
+            g_pen.bg = TERMUI_XCOLOR_INDEX(p - 40);
+        } else if (p >= 100 && p <= 107) {
+            g_pen.bg = TERMUI_XCOLOR_INDEX(p - 100 + 8);
+        } else if (p == 49) {
+            g_pen.bg = TERMUI_XCOLOR_DEFAULT;
+        } else if ((p == 38 && !sgr_extended(&i, &g_pen.fg)) ||
+                   (p == 48 && !sgr_extended(&i, &g_pen.bg))) {
+            return;  /* Malformed: the rest is unreliable */
+        }
+        /* Attributes the model does not track are ignored */
+    }
+}
+
+static void dispatch_csi(unsigned char final) {
+    g_stats.sequences++;
+
+    if (g_private) {
+        /* DEC modes: only synchronized output end marks a frame */
+        if (final == 'l' && g_param_count > 0 && g_params[0] == 2026) {
+            g_stats.frames++;
+        }
+        return;
+    }
+
+    switch (final) {
+        case 'H':
+        case 'f':
+            g_cur_y = param(0, 1) - 1;
+            g_cur_x = param(1, 1) - 1;
+            if (g_cur_y >= g_height) g_cur_y = g_height - 1;
+            if (g_cur_x >= g_width) g_cur_x = g_width - 1;
+            g_stats.cursor_moves++;
+            break;
+        case 'A':
+            g_cur_y -= param(0, 1);
+            if (g_cur_y < 0) g_cur_y = 0;
+            g_stats.cursor_moves++;
+            break;
+        case 'B':
+            g_cur_y += param(0, 1);
+            if (g_cur_y >= g_height) g_cur_y = g_height - 1;
+            g_stats.cursor_moves++;
+            break;
+        case 'C':
+            g_cur_x += param(0, 1);
+            if (g_cur_x >= g_width) g_cur_x = g_width - 1;
+            g_stats.cursor_moves++;
+            break;
+        case 'D':
+            g_cur_x -= param(0, 1);
+            if (g_cur_x < 0) g_cur_x = 0;
+            g_stats.cursor_moves++;
+            break;
+        case 'J':
+            if (g_param_count > 0 && g_params[0] == 2) {
+                clear_cells(g_cells, (size_t)g_width * (size_t)g_height);
+            }
+            break;
+        case 'm':
+            apply_sgr();
+            g_stats.color_changes++;
+            break;
+        case 'r':
+            g_top = param(0, 1) - 1;
+            g_bottom = param(1, g_height) - 1;
+            if (g_bottom >= g_height) g_bottom = g_height - 1;
+            if (g_top > g_bottom) {
+                g_top = 0;
+                g_bottom = g_height - 1;
+            }
+            g_cur_x = g_cur_y = 0;
+            break;
+        case 'S':
+            scroll_region(param(0, 1));
+            break;
+        case 'T':
+            scroll_region(-param(0, 1));
+            break;
+        default:
+            break;
+    }
+}
+
+/* Draw a codepoint at the cursor; autowrap is off, as termui sets it */
+static void put_codepoint(uint32_t cp) {
+    int width = termui_codepoint_width(cp);
+    if (width == 0) {
+        return;  /* Combining mark: the model keeps base codepoints only */
+    }
+    if (g_cur_x + width > g_width) {
+        g_cur_x = g_width - width;  /* Overwrites the last column(s) */
+        if (g_cur_x < 0) return;
+    }
+
+    vt_cell_t *cell = g_cells + (size_t)g_cur_y * (size_t)g_width + (size_t)g_cur_x;
+    cell[0].codepoint = cp;
+    cell[0].style = g_pen;
+    if (width == 2) {
+        cell[1].codepoint = 0;
+        cell[1].style = g_pen;
+    }
+    g_cur_x += width;
+    if (g_cur_x > g_width - 1) {
+        g_cur_x = g_width - 1;
+    }
+    g_stats.glyphs++;
+}
+
+static void feed_ground(unsigned char c) {
+    if (g_utf8_need > 0) {
+        if ((c & 0xc0) == 0x80) {
+            g_utf8[g_utf8_len++] = c;
+            if (g_utf8_len == g_utf8_need) {
+                uint32_t cp;
+                termui_utf8_decode((const char *)g_utf8, &cp);
+                g_utf8_need = g_utf8_len = 0;
+                put_codepoint(cp);
+            }
+            return;
+        }
+        g_utf8_need = g_utf8_len = 0;
+        put_codepoint(0xfffd);  /* Truncated sequence, then handle c */
+    }
+
+    if (c == 0x1b) {
+        g_state = VT_ESCAPE;
+    } else if (c == '\r') {
+        g_cur_x = 0;
+        g_stats.cursor_moves++;
+    } else if (c == '\n') {
+        /* Line feed only; the column is kept (no ONLCR here) */
+        if (g_cur_y == g_bottom) {
+            scroll_region(1);
+        } else if (g_cur_y < g_height - 1) {
+            g_cur_y++;
+        }
+        g_stats.cursor_moves++;
+    } else if (c >= 0x20 && c < 0x7f) {
+        put_codepoint(c);
+    } else if (c >= 0xc0 && c < 0xf8) {
+        g_utf8[0] = c;
+        g_utf8_len = 1;
+        g_utf8_need = c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+    }
+    /* Other control bytes are never emitted by the encoder */
+}
+
+size_t termui_headless_feed(const char *bytes, size_t len) {
+    /* A limited model stops reading, like a congested terminal */
+    if (g_accept >= 0 && len > (size_t)g_accept) {
+        len = (size_t)g_accept;
+    }
+    if (g_accept >= 0) {
+        g_accept -= (long)len;
+    }
+
+    g_stats.bytes += len;
+    if (!g_cells) return len;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)bytes[i];
+        switch (g_state) {
+            case VT_GROUND:
+                feed_ground(c);
+                break;
+            case VT_ESCAPE:
+                if (c == '[') {
+                    g_state = VT_CSI;
+                    g_param_count = 0;
+                    g_private = false;
+                } else {
+                    g_stats.sequences++;  /* Two-byte escape */
+                    g_state = VT_GROUND;
+                }
+                break;
+            case VT_CSI:
+                if (c >= '0' && c <= '9') {
+                    if (g_param_count == 0) {
+                        g_params[g_param_count++] = 0;
+                    }
+                    int *p = &g_params[g_param_count - 1];
+                    if (*p < 100000) *p = *p * 10 + (c - '0');
+                } else if (c == ';') {
+                    if (g_param_count == 0) {
+                        g_params[g_param_count++] = 0;
+                    }
+                    if (g_param_count < MAX_PARAMS) {
+                        g_params[g_param_count++] = 0;
+                    }
+                } else if (c == '?') {
+                    g_private = true;
+                } else if (c >= 0x40 && c <= 0x7e) {
+                    dispatch_csi(c);
+                    g_state = VT_GROUND;
+                }
+                break;
+        }
+    }
+    return len;
+}
+
+bool termui_headless_get_cell(int x, int y, uint32_t *codepoint, termui_color_t *color) {
+    if (!g_cells || x < 0 || y < 0 || x >= g_width || y >= g_height) {
+        return false;
+    }
+
+    const vt_cell_t *cell = g_cells + (size_t)y * (size_t)g_width + (size_t)x;
+    if (codepoint) *codepoint = cell->codepoint;
+    if (color) *color = termui_xcolor_basic(cell->style.fg, NULL);
+    return true;
+}
+
+bool termui_headless_get_style(int x, int y, termui_style_t *style) {
+    if (!g_cells || x < 0 || y < 0 || x >= g_width || y >= g_height) {
+        return false;
+    }
+
+    if (style) *style = g_cells[(size_t)y * (size_t)g_width + (size_t)x].style;
+    return true;
+}
+
+/* UTF-8 encode cp into out (at least 4 bytes); returns the length */
+static size_t utf8_encode(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xc0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xe0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+size_t termui_headless_get_row(int y, char *out, size_t size) {
+    if (!out || size == 0) return 0;
+
+    size_t len = 0;
+    if (g_cells && y >= 0 && y < g_height) {
+        const vt_cell_t *row = g_cells + (size_t)y * (size_t)g_width;
+        for (int x = 0; x < g_width; x++) {
+            if (row[x].codepoint == 0) continue;  /* Wide glyph's right half */
+
+            char bytes[4];
+            size_t n = utf8_encode(row[x].codepoint, bytes);
+            if (len + n >= size) break;
+            memcpy(out + len, bytes, n);
+            len += n;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+void termui_headless_get_stats(termui_headless_stats_t *stats) {
+    if (!stats) return;
+
+    termui_output_lock();
+    *stats = g_stats;
+    termui_output_unlock();
+}
+
+void termui_headless_reset_stats(void) {
+    termui_output_lock();
+    memset(&g_stats, 0, sizeof(g_stats));
+    termui_output_unlock();
+}
+
+int termui_headless_resize(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return TERMUI_INVALID;
+    }
+    if (!termui_is_initialized() || termui_active_backend() != TERMUI_BACKEND_HEADLESS) {
+        return TERMUI_NOTINIT;
+    }
+
+    termui_output_lock();
+    bool ok = resize_screen(width, height);
+    termui_output_unlock();
+    if (!ok) {
+        return TERMUI_NOMEM;
+    }
+
+    /* Reported like SIGWINCH: the app sees TERMUI_INPUT_RESIZE */
+    termui_resize_notify();
+    return TERMUI_OK;
+}
+
+int termui_headless_limit_output(long bytes) {
+    if (!termui_is_initialized() || termui_active_backend() != TERMUI_BACKEND_HEADLESS) {
+        return TERMUI_NOTINIT;
+    }
+
+    termui_output_lock();
+    g_accept = bytes < 0 ? -1 : bytes;
+    termui_output_unlock();
+    return TERMUI_OK;
+}
+
+int termui_headless_send_input(const char *bytes, size_t len) {
+    if (!bytes) {
+        return TERMUI_INVALID;
+    }
+    if (!termui_is_initialized() || termui_active_backend() != TERMUI_BACKEND_HEADLESS) {
+        return TERMUI_NOTINIT;
+    }
+    int rc = termui_ansi_push_input(bytes, len);
+    if (rc == TERMUI_OK) {
+        termui_input_wake();
+    }
+    return rc;
+}
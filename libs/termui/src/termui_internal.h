@@ -0,0 +1,411 @@
+/*
+ * termui - Internal Interfaces
+ *
+ * Shared between the library's translation units. Not installed.
+ */
+
+#ifndef TERMUI_INTERNAL_H
+#define TERMUI_INTERNAL_H
+
+#include "termui.h"
+#include <stdint.h>
+
+/*
+ * Packed Cells
+ *
+ * One 32-bit word per cell so a cell write touches a single location
+ * and two cells compare with one integer compare:
+ *
+ *   bits  0-15  glyph (ASCII, or an interned id from termui_glyph.c)
+ *   bits 16-30  style (an interned id from termui_style.c; ids 0-7 are
+ *               the termui_color_t foregrounds)
+ *   bit  31     reserved, always 0
+ */
+typedef uint32_t termui_cell_t;
+
+#define TERMUI_CELL_GLYPH_MASK  0xffffu
+#define TERMUI_CELL_STYLE_SHIFT 16
+#define TERMUI_CELL_STYLE_MASK  0x7fffu
+
+/* Glyph ids at or above this refer to the interned glyph table */
+#define TERMUI_GLYPH_FIRST 0x80u
+
+/* Right half of a double-width glyph; emits nothing on its own */
+#define TERMUI_GLYPH_CONT 0xffffu
+
+/* One past the last id the glyph table hands out */
+#define TERMUI_GLYPH_LIMIT TERMUI_GLYPH_CONT
+
+/* Blank cell: a space in the default colors */
+#define TERMUI_CELL_BLANK ((termui_cell_t)' ')
+
+/* Presented-copy cell whose screen contents are unknown (uncovered by a
+ * resize); uses the reserved bit, so it never matches a drawn cell */
+#define TERMUI_CELL_UNKNOWN ((termui_cell_t)1 << 31)
+
+static inline termui_cell_t termui_cell_make_styled(unsigned int glyph, unsigned int style) {
+    return (termui_cell_t)(glyph & TERMUI_CELL_GLYPH_MASK) |
+           ((termui_cell_t)(style & TERMUI_CELL_STYLE_MASK) << TERMUI_CELL_STYLE_SHIFT);
+}
+
+/* Cell in a basic color; out-of-range colors become the default */
+static inline termui_cell_t termui_cell_make(unsigned int glyph, termui_color_t fg) {
+    return termui_cell_make_styled(glyph, (unsigned int)fg <= TERMUI_COLOR_MAGENTA ? (unsigned int)fg : 0u);
+}
+
+static inline unsigned int termui_cell_glyph(termui_cell_t cell) {
+    return cell & TERMUI_CELL_GLYPH_MASK;
+}
+
+static inline unsigned int termui_cell_style(termui_cell_t cell) {
+    return (cell >> TERMUI_CELL_STYLE_SHIFT) & TERMUI_CELL_STYLE_MASK;
+}
+
+/* Frame buffer structure */
+struct termui_buffer {
+    int width;
+    int height;
+    int stride;            /* Cells between rows (width unless a view) */
+    bool view;             /* Cells belong to another buffer (a tile) */
+    size_t capacity;       /* Cells allocated in both copies (not views) */
+    termui_cell_t *cells;  /* Packed cell data */
+    struct termui_front *front; /* Presented frame and damage (views: damage only) */
+};
+
+/* Last presented frame and damage map
+ * Kept behind a pointer so render can update it through a const buffer. */
+struct termui_front {
+    termui_cell_t *cells;   /* Cells as last presented */
+    int *dirty_lo;          /* Per row: first dirty column (width if clean) */
+    int *dirty_hi;          /* Per row: one past last dirty column (0 if clean) */
+    uint64_t *row_hash;     /* Scratch for scroll detection: 2 per row */
+    unsigned char *row_state; /* Scratch for scroll detection: 1 per row */
+    int rows;               /* Rows allocated in the per-row arrays */
+    bool dirty;             /* Any row has a non-empty span */
+    bool valid;             /* Contents match the terminal */
+    unsigned long epoch;    /* Screen epoch after our last present */
+    termui_tiles_t *tiles;  /* Tile set drawing into this buffer, if any */
+};
+
+/* Widen the dirty span of row y to include columns [x0, x1) */
+void termui_buffer_mark_dirty(termui_buffer_t *buf, int y, int x0, int x1);
+
+/* Write n prepared narrow cells into row y from column x, clipped, with
+ * damage and wide-glyph splits as the drawing functions do */
+void termui_buffer_put_cells(termui_buffer_t *buf, int x, int y, const termui_cell_t *cells, int n);
+
+/* Reset every row of the damage map to clean */
+void termui_buffer_clear_dirty(const termui_buffer_t *buf);
+
+/* View of the rectangle (x, y, width, height) of parent, which must lie
+ * inside it; drawing into the view marks only the view's damage */
+termui_buffer_t* termui_buffer_view_create(termui_buffer_t *parent, int x, int y, int width, int height);
+
+/* Point a view at another rectangle of parent, dropping its damage */
+bool termui_buffer_view_place(termui_buffer_t *view, termui_buffer_t *parent, int x, int y, int width, int height);
+
+/* Fold a view's damage into its parent, the view lying at (x, y) */
+void termui_buffer_view_commit(termui_buffer_t *view, termui_buffer_t *parent, int x, int y);
+
+/* Free a view (not the cells) */
+void termui_buffer_view_destroy(termui_buffer_t *view);
+
+/*
+ * Tiles (termui_tile.c)
+ */
+
+/* Fold the damage drawn into buf's tiles into buf's own damage map.
+ * Only while no thread is drawing into the tiles. */
+void termui_tiles_collect(const termui_buffer_t *buf);
+
+/* Re-split buf among its tiles after a resize; tile handles stay valid */
+bool termui_tiles_layout(termui_buffer_t *buf);
+
+/*
+ * Shape Rasterizers (termui_raster.c)
+ */
+
+/* A target receiving shapes as horizontal spans [x, x + length) of row
+ * y, always inside (0, 0, width, height) */
+typedef struct {
+    int width;
+    int height;
+    void (*span)(void *target, int x, int y, int length);
+    void *target;
+} termui_raster_t;
+
+void termui_raster_line(const termui_raster_t *r, int x0, int y0, int x1, int y1);
+void termui_raster_polyline(const termui_raster_t *r, const termui_point_t *points, int count);
+void termui_raster_circle(const termui_raster_t *r, int cx, int cy, int radius);
+
+/* Filled polygon (even-odd), edges included */
+void termui_raster_polygon(const termui_raster_t *r, const termui_point_t *points, int count);
+
+/*
+ * Output Queue (termui_render.c)
+ */
+
+/* termui_buffer_render for callers already holding the output lock */
+void termui_buffer_render_locked(const termui_buffer_t *buf);
+
+/* Drop buf if it is the frame deferred by backpressure (on destroy) */
+void termui_render_forget(const termui_buffer_t *buf);
+
+/* Descriptor to poll for POLLOUT while output is queued, else -1 */
+int termui_output_poll_fd(void);
+
+/* Push queued output and render a deferred frame once it has drained */
+void termui_output_service(void);
+
+/*
+ * Cell Kernels (termui_simd.c)
+ */
+
+/* Set n cells starting at dst to value */
+void termui_cells_fill(termui_cell_t *dst, termui_cell_t value, size_t n);
+
+/* Set a width x height rectangle of cells, rows stride cells apart */
+void termui_cells_fill_rect(termui_cell_t *dst, size_t stride, size_t width,
+                            size_t height, termui_cell_t value);
+
+/* Find the first and last index where n cells of a and b differ
+ * Returns false, leaving first/last untouched, if they are identical */
+bool termui_cells_diff(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                       size_t *first, size_t *last);
+
+/*
+ * Glyph Table (termui_glyph.c)
+ */
+
+/* Build the display width table (idempotent, also done lazily) */
+void termui_glyph_init(void);
+
+/* Display width of a codepoint: 0, 1 or 2 */
+int termui_codepoint_width(uint32_t cp);
+
+/* Decode one UTF-8 sequence into cp (U+FFFD if malformed)
+ * Returns the number of bytes consumed, at least 1 */
+size_t termui_utf8_decode(const char *str, uint32_t *cp);
+
+/* Decode one glyph (a codepoint plus any combining marks) from str
+ * Returns bytes consumed and stores the glyph id and its width */
+size_t termui_utf8_next_glyph(const char *str, unsigned int *glyph, int *width);
+
+/* Intern a UTF-8 cluster with the given width; returns its glyph id */
+unsigned int termui_glyph_intern(const char *bytes, size_t len, int width);
+
+/* Glyph id for a single codepoint */
+unsigned int termui_glyph_from_codepoint(uint32_t cp);
+
+/* UTF-8 bytes of an interned glyph */
+const char* termui_glyph_bytes(unsigned int glyph, size_t *len);
+
+/* Display width of a glyph id (0 for TERMUI_GLYPH_CONT) */
+int termui_glyph_width(unsigned int glyph);
+
+/* First codepoint of a glyph id */
+uint32_t termui_glyph_codepoint(unsigned int glyph);
+
+/*
+ * Styles (termui_style.c)
+ */
+
+/* Choose the color depth (auto-detected from the backend and env) */
+void termui_style_init(termui_color_mode_t requested);
+
+/* Intern a style; returns its id (a basic color if the table is full) */
+unsigned int termui_style_intern(const termui_style_t *style);
+
+/* Style of an id (the default style if unknown) */
+const termui_style_t* termui_style_get(unsigned int id);
+
+/* Reduce a color to what a color mode can show */
+termui_xcolor_t termui_xcolor_reduce(termui_xcolor_t color, termui_color_mode_t mode);
+
+/* Nearest basic color, for ncurses color pairs; bright is set for the
+ * high-intensity half of the 16 ANSI colors */
+termui_color_t termui_xcolor_basic(termui_xcolor_t color, bool *bright);
+
+/*
+ * Core State
+ */
+
+/* Backend selected at termui_init */
+termui_backend_t termui_active_backend(void);
+
+/* Whether frames go through the ANSI encoder (ANSI or headless backend) */
+bool termui_backend_encodes(void);
+
+/* Flag a resize and wake input waits, as SIGWINCH does */
+void termui_resize_notify(void);
+
+/* Whether color output is enabled and supported */
+bool termui_colors_active(void);
+
+/*
+ * Screen epoch
+ *
+ * A counter bumped whenever the terminal contents may no longer match
+ * what a buffer last presented (init, resize, or another buffer being
+ * presented). Buffers remember the epoch of their last present and fall
+ * back to a full repaint when it differs.
+ */
+
+/* Current screen epoch */
+unsigned long termui_screen_epoch(void);
+
+/* Advance the screen epoch and return the new value */
+unsigned long termui_screen_touch(void);
+
+/* Held around terminal output and ncurses input so a render thread
+ * never interleaves with resize handling or getch */
+void termui_output_lock(void);
+void termui_output_unlock(void);
+
+/* Queue an action from a non-keyboard source (key -1) */
+void termui_input_push(termui_input_t input, uint64_t time_ns);
+
+/* True while pushed actions are waiting to be read */
+bool termui_input_queued(void);
+
+/*
+ * Gamepads (termui_gamepad.c)
+ */
+
+/* Read pending events from every open gamepad without blocking */
+void termui_gamepad_pump(void);
+
+/* Close every gamepad's device; handles stay valid until
+ * termui_gamepad_close */
+void termui_gamepad_disconnect_all(void);
+
+/*
+ * Event Wait (termui_event.c)
+ */
+
+/* Create the wake self-pipe */
+int termui_event_init(void);
+
+/* Close the self-pipe and drop all watched fds and timers */
+void termui_event_cleanup(void);
+
+/* Block until input_fd is readable (returns true), or until a wake,
+ * watched fd, timer or timeout_ms (-1 for none) ends the wait (false).
+ * Watched fd and timer callbacks run before returning */
+bool termui_event_wait(int input_fd, int timeout_ms);
+
+/* Watch fd for reading on termui's own behalf (gamepads): unlike an app
+ * watch, its callback only ends the wait if it queued an action.
+ * Stopped with termui_input_unwatch_fd */
+int termui_event_watch_internal(int fd, termui_fd_fn callback, void *user);
+
+/*
+ * ANSI Backend (termui_ansi.c)
+ */
+
+/* Put the tty in raw mode and switch to the alternate screen
+ * If headless, no tty is touched and output feeds termui_headless_feed */
+int termui_ansi_init(bool headless);
+
+/* Restore the tty to the state saved by termui_ansi_init */
+void termui_ansi_cleanup(void);
+
+/* Query the tty size, falling back to 80x24 */
+void termui_ansi_get_size(int *width, int *height);
+
+/* Clear the screen (after a resize) */
+void termui_ansi_clear(void);
+
+/* Whether the screen still shows the last frame after a resize to the
+ * given height (else it must be cleared and repainted) */
+bool termui_ansi_resize_keeps(int height);
+
+/* Append raw input bytes for termui_ansi_getch to decode */
+int termui_ansi_push_input(const char *bytes, size_t len);
+
+/* Whether undecoded input bytes are buffered */
+bool termui_ansi_has_input(void);
+
+/* Read one decoded key without blocking
+ * Returns ncurses KEY_* codes for special keys, -1 if none available.
+ * A partial escape sequence is held until it completes or its delay
+ * runs out, when the ESC is returned on its own */
+int termui_ansi_getch(void);
+
+/* Milliseconds until a held partial escape sequence is given up on,
+ * -1 if none is held */
+int termui_ansi_input_delay(void);
+
+/* Start encoding a frame into the output buffer */
+void termui_ansi_frame_begin(void);
+
+/* Encode cells [x0, x1) of row y */
+void termui_ansi_frame_run(const termui_buffer_t *buf, int y, int x0, int x1);
+
+/* Scroll rows [top, bottom] by n lines (up if positive) using a scroll
+ * region; exposed lines are cleared to the default background */
+void termui_ansi_frame_scroll(int top, int bottom, int n);
+
+/* Finish the frame and queue it, writing what the terminal accepts
+ * Returns false if the output buffer could not grow: the frame was
+ * discarded unsent and the next one must repaint everything */
+bool termui_ansi_frame_end(void);
+
+/* Discard the last frame if not a byte of it has been written and
+ * nothing was queued after it; the terminal is left as it was before.
+ * Returns false if it is already (partly) out */
+bool termui_ansi_frame_drop(void);
+
+/* Write more queued output without blocking; returns bytes still queued */
+size_t termui_ansi_pending(void);
+
+/* Output descriptor (non-blocking when the tty could be reopened) */
+int termui_ansi_out_fd(void);
+
+/* Total bytes the terminal has accepted */
+uint64_t termui_ansi_bytes_written(void);
+
+/* Total bytes of frames encoded */
+uint64_t termui_ansi_bytes_encoded(void);
+
+/* Total write() calls made on the output */
+uint64_t termui_ansi_write_calls(void);
+
+/* Bytes written but still in the kernel tty output queue (TIOCOUTQ) */
+size_t termui_ansi_tty_queue(void);
+
+/*
+ * Frame Statistics (termui_stats.c)
+ */
+
+/* Whether stats are being collected (cheap; checked per frame) */
+bool termui_stats_active(void);
+
+/* Monotonic clock in nanoseconds for frame timing */
+uint64_t termui_stats_clock(void);
+
+/* Record a presented frame; called with the output lock held */
+void termui_stats_record_frame(uint64_t render_ns, uint32_t cells);
+
+/* Count input events read, and frame loop deadlines missed */
+void termui_stats_note_input(int events);
+void termui_stats_note_missed(uint64_t deadlines);
+
+/*
+ * Headless Backend (termui_headless.c)
+ */
+
+/* Create the in-memory screen (0 for the 80x24 default) */
+int termui_headless_init(int width, int height);
+
+/* Free the in-memory screen */
+void termui_headless_cleanup(void);
+
+/* Size of the in-memory screen */
+void termui_headless_get_size(int *width, int *height);
+
+/* Interpret encoder output as a terminal would
+ * Returns the bytes accepted, fewer while output is limited */
+size_t termui_headless_feed(const char *bytes, size_t len);
+
+#endif /* TERMUI_INTERNAL_H */
@@ -0,0 +1,348 @@
+/*
+ * termui - Layer Compositor
+ *
+ * A stack of layer buffers composited into one target buffer. Each layer
+ * has a z-order, an offset and its own buffer; cells with a NUL glyph
+ * are transparent and show the layers beneath.
+ *
+ * Layers reuse the buffer damage map: the compositor treats compose as
+ * the layer's "present", diffs each layer's dirty spans against its
+ * presented copy, and turns the result into one dirty rectangle per
+ * layer. Moving, hiding, restacking or resizing a layer damages its old
+ * and new rectangles. Only damaged spans of the target are recomposited;
+ * resizing the target recomposites all of it.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Transparent cells have a NUL glyph */
+#define CELL_OPAQUE(c) (termui_cell_glyph(c) != 0)
+
+struct termui_layer {
+    termui_buffer_t *buf;
+    int x, y;               /* Offset in the target */
+    int z;                  /* Stacking order, higher is on top */
+    bool visible;
+
+    /* Placement as of the last compose */
+    int placed_x, placed_y, placed_z;
+    int placed_w, placed_h;
+    bool placed_visible;
+    bool placed;            /* Composited at least once */
+};
+
+struct termui_compositor {
+    termui_buffer_t *target;
+    termui_layer_t **layers;    /* Sorted by z, bottom first */
+    int count;
+    int capacity;
+    int *damage_lo;             /* Per target row damaged span */
+    int *damage_hi;
+    int width, height;          /* Target size the damage map is for */
+    int rows;                   /* Rows allocated in the damage map */
+    bool full;                  /* Recomposite everything */
+};
+
+/* Follow a resize of the target: reset the damage map and recomposite
+ * everything. Returns false if the map could not grow */
+static bool fit_target(termui_compositor_t *comp) {
+    termui_buffer_t *target = comp->target;
+    if (comp->width == target->width && comp->height == target->height) {
+        return true;
+    }
+
+    if (target->height > comp->rows) {
+        int *lo = realloc(comp->damage_lo, (size_t)target->height * sizeof(int));
+        if (!lo) return false;
+        comp->damage_lo = lo;
+        int *hi = realloc(comp->damage_hi, (size_t)target->height * sizeof(int));
+        if (!hi) return false;
+        comp->damage_hi = hi;
+        comp->rows = target->height;
+    }
+
+    comp->width = target->width;
+    comp->height = target->height;
+    for (int y = 0; y < comp->height; y++) {
+        comp->damage_lo[y] = comp->width;
+        comp->damage_hi[y] = 0;
+    }
+    comp->full = true;
+    return true;
+}
+
+/* Widen target damage by a rectangle, clipped to the target */
+static void damage_rect(termui_compositor_t *comp, int x, int y, int w, int h) {
+    if (!fit_target(comp)) return;
+
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > comp->width ? comp->width : x + w;
+    int y1 = y + h > comp->height ? comp->height : y + h;
+
+    for (int row = y0; row < y1 && x0 < x1; row++) {
+        if (x0 < comp->damage_lo[row]) comp->damage_lo[row] = x0;
+        if (x1 > comp->damage_hi[row]) comp->damage_hi[row] = x1;
+    }
+}
+
+termui_compositor_t* termui_compositor_create(termui_buffer_t *target) {
+    if (!target || target->view) {
+        return NULL;
+    }
+
+    termui_compositor_t *comp = calloc(1, sizeof(termui_compositor_t));
+    if (!comp) {
+        return NULL;
+    }
+
+    comp->target = target;
+    if (!fit_target(comp)) {
+        termui_compositor_destroy(comp);
+        return NULL;
+    }
+    return comp;
+}
+
+void termui_compositor_destroy(termui_compositor_t *comp) {
+    if (!comp) return;
+
+    for (int i = 0; i < comp->count; i++) {
+        termui_buffer_destroy(comp->layers[i]->buf);
+        free(comp->layers[i]);
+    }
+    free(comp->layers);
+    free(comp->damage_lo);
+    free(comp->damage_hi);
+    free(comp);
+}
+
+/* Keep layers ordered by z; equal z keeps insertion order */
+static void sort_layers(termui_compositor_t *comp) {
+    for (int i = 1; i < comp->count; i++) {
+        termui_layer_t *layer = comp->layers[i];
+        int j = i - 1;
+        while (j >= 0 && comp->layers[j]->z > layer->z) {
+            comp->layers[j + 1] = comp->layers[j];
+            j--;
+        }
+        comp->layers[j + 1] = layer;
+    }
+}
+
+termui_layer_t* termui_compositor_add_layer(termui_compositor_t *comp, int x, int y,
+                                            int width, int height, int z) {
+    if (!comp) return NULL;
+
+    if (comp->count == comp->capacity) {
+        int capacity = comp->capacity ? comp->capacity * 2 : 4;
+        termui_layer_t **layers = realloc(comp->layers, (size_t)capacity * sizeof(termui_layer_t *));
+        if (!layers) {
+            return NULL;
+        }
+        comp->layers = layers;
+        comp->capacity = capacity;
+    }
+
+    termui_layer_t *layer = calloc(1, sizeof(termui_layer_t));
+    if (!layer) {
+        return NULL;
+    }
+
+    layer->buf = termui_buffer_create(width, height);
+    if (!layer->buf) {
+        free(layer);
+        return NULL;
+    }
+
+    layer->x = x;
+    layer->y = y;
+    layer->z = z;
+    layer->visible = true;
+    termui_layer_clear(layer);
+
+    comp->layers[comp->count++] = layer;
+    sort_layers(comp);
+    return layer;
+}
+
+void termui_compositor_remove_layer(termui_compositor_t *comp, termui_layer_t *layer) {
+    if (!comp || !layer) return;
+
+    for (int i = 0; i < comp->count; i++) {
+        if (comp->layers[i] != layer) continue;
+
+        if (layer->placed && layer->placed_visible) {
+            damage_rect(comp, layer->placed_x, layer->placed_y, layer->placed_w, layer->placed_h);
+        }
+        memmove(&comp->layers[i], &comp->layers[i + 1],
+                (size_t)(comp->count - i - 1) * sizeof(termui_layer_t *));
+        comp->count--;
+        termui_buffer_destroy(layer->buf);
+        free(layer);
+        return;
+    }
+}
+
+termui_buffer_t* termui_layer_buffer(termui_layer_t *layer) {
+    return layer ? layer->buf : NULL;
+}
+
+void termui_layer_clear(termui_layer_t *layer) {
+    if (!layer) return;
+
+    termui_buffer_t *buf = layer->buf;
+    termui_cells_fill(buf->cells, 0, (size_t)buf->width * (size_t)buf->height);
+    for (int y = 0; y < buf->height; y++) {
+        termui_buffer_mark_dirty(buf, y, 0, buf->width);
+    }
+}
+
+void termui_layer_set_offset(termui_layer_t *layer, int x, int y) {
+    if (!layer) return;
+    layer->x = x;
+    layer->y = y;
+}
+
+void termui_layer_set_visible(termui_layer_t *layer, bool visible) {
+    if (!layer) return;
+    layer->visible = visible;
+}
+
+void termui_layer_set_z(termui_compositor_t *comp, termui_layer_t *layer, int z) {
+    if (!comp || !layer || layer->z == z) return;
+    layer->z = z;
+    sort_layers(comp);
+}
+
+/* Diff a layer against its last composited copy and damage the target
+ * with the bounding rectangle of what changed */
+static void collect_layer_damage(termui_compositor_t *comp, termui_layer_t *layer) {
+    termui_buffer_t *buf = layer->buf;
+    struct termui_front *f = buf->front;
+    bool moved = !layer->placed || layer->placed_x != layer->x || layer->placed_y != layer->y ||
+                 layer->placed_visible != layer->visible || layer->placed_z != layer->z ||
+                 layer->placed_w != buf->width || layer->placed_h != buf->height;
+
+    if (moved) {
+        if (layer->placed && layer->placed_visible) {
+            damage_rect(comp, layer->placed_x, layer->placed_y, layer->placed_w, layer->placed_h);
+        }
+        if (layer->visible) {
+            damage_rect(comp, layer->x, layer->y, buf->width, buf->height);
+        }
+    }
+
+    if (f->dirty) {
+        int rx0 = buf->width, rx1 = 0, ry0 = buf->height, ry1 = 0;
+        for (int y = 0; y < buf->height; y++) {
+            int lo = f->dirty_lo[y];
+            int hi = f->dirty_hi[y];
+            if (lo >= hi) continue;
+
+            size_t row = (size_t)y * (size_t)buf->width + (size_t)lo;
+            size_t first, last;
+            if (termui_cells_diff(buf->cells + row, f->cells + row, (size_t)(hi - lo), &first, &last)) {
+                if (lo + (int)first < rx0) rx0 = lo + (int)first;
+                if (lo + (int)last + 1 > rx1) rx1 = lo + (int)last + 1;
+                if (y < ry0) ry0 = y;
+                ry1 = y + 1;
+            }
+
+            /* Take the span as composited */
+            memcpy(f->cells + row, buf->cells + row, (size_t)(hi - lo) * sizeof(termui_cell_t));
+        }
+        termui_buffer_clear_dirty(buf);
+
+        if (!moved && layer->visible && rx0 < rx1) {
+            damage_rect(comp, layer->x + rx0, layer->y + ry0, rx1 - rx0, ry1 - ry0);
+        }
+    }
+
+    layer->placed = true;
+    layer->placed_x = layer->x;
+    layer->placed_y = layer->y;
+    layer->placed_z = layer->z;
+    layer->placed_w = buf->width;
+    layer->placed_h = buf->height;
+    layer->placed_visible = layer->visible;
+}
+
+/* Composite target row y over [x0, x1) from the layer stack */
+static void compose_span(termui_compositor_t *comp, int y, int x0, int x1) {
+    termui_buffer_t *target = comp->target;
+    termui_cell_t *out = target->cells + (size_t)y * (size_t)target->width;
+
+    /* A double-width glyph cut at the span's edge is repaired or blanked
+     * in the cell beside it, so that cell is recomposited too */
+    int lo = x0 > 0 ? x0 - 1 : x0;
+    int hi = x1 < target->width ? x1 + 1 : x1;
+    termui_cells_fill(out + lo, TERMUI_CELL_BLANK, (size_t)(hi - lo));
+
+    /* Painter's order: bottom layer first */
+    for (int i = 0; i < comp->count; i++) {
+        const termui_layer_t *layer = comp->layers[i];
+        const termui_buffer_t *buf = layer->buf;
+        int ly = y - layer->y;
+        if (!layer->visible || ly < 0 || ly >= buf->height) continue;
+
+        int lx0 = lo > layer->x ? lo : layer->x;
+        int lx1 = hi < layer->x + buf->width ? hi : layer->x + buf->width;
+        const termui_cell_t *src = buf->cells + (size_t)ly * (size_t)buf->width;
+        for (int x = lx0; x < lx1; x++) {
+            termui_cell_t cell = src[x - layer->x];
+            if (CELL_OPAQUE(cell)) {
+                out[x] = cell;
+            }
+        }
+    }
+
+    /* Layers may cut double-width glyphs in half at their edges */
+    for (int x = lo; x < hi; x++) {
+        unsigned int glyph = termui_cell_glyph(out[x]);
+        bool lead = glyph != TERMUI_GLYPH_CONT && termui_glyph_width(glyph) == 2;
+        if (lead && (x + 1 >= target->width || termui_cell_glyph(out[x + 1]) != TERMUI_GLYPH_CONT)) {
+            out[x] = (out[x] & ~(termui_cell_t)TERMUI_CELL_GLYPH_MASK) | ' ';
+        } else if (glyph == TERMUI_GLYPH_CONT &&
+                   (x == 0 || termui_glyph_width(termui_cell_glyph(out[x - 1])) != 2)) {
+            out[x] = (out[x] & ~(termui_cell_t)TERMUI_CELL_GLYPH_MASK) | ' ';
+        }
+    }
+
+    termui_buffer_mark_dirty(target, y, lo, hi);
+}
+
+int termui_compositor_compose(termui_compositor_t *comp) {
+    if (!comp) return 0;
+
+    if (!fit_target(comp)) return 0;
+
+    for (int i = 0; i < comp->count; i++) {
+        collect_layer_damage(comp, comp->layers[i]);
+    }
+    if (comp->full) {
+        damage_rect(comp, 0, 0, comp->width, comp->height);
+        comp->full = false;
+    }
+
+    int cells = 0;
+    for (int y = 0; y < comp->height; y++) {
+        int lo = comp->damage_lo[y];
+        int hi = comp->damage_hi[y];
+        if (lo >= hi) continue;
+
+        compose_span(comp, y, lo, hi);
+        cells += hi - lo;
+        comp->damage_lo[y] = comp->width;
+        comp->damage_hi[y] = 0;
+    }
+    return cells;
+}
+
+void termui_compositor_invalidate(termui_compositor_t *comp) {
+    if (!comp) return;
+    comp->full = true;
+}
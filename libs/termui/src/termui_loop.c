@@ -0,0 +1,328 @@
+/*
+ * termui - Frame Loop
+ *
+ * Fixed-timestep scheduler: update runs at a fixed rate, catching up
+ * after a slow frame up to a bounded number of steps, and draw runs at
+ * a capped rate only when an update (or a redraw request) happened since
+ * the last frame. Between deadlines the loop sleeps on an absolute
+ * CLOCK_MONOTONIC deadline, so an idle TUI costs one wakeup per update
+ * tick instead of a spinning core.
+ *
+ * Adaptive pacing: after each frame the loop compares the bytes frames
+ * produce with the bytes that actually leave the tty (output written
+ * minus growth of the kernel queue, TIOCOUTQ). While output backs up, the
+ * render rate drops to what the measured drain rate can carry; once the
+ * queue is empty again it climbs back towards the cap. A local terminal
+ * never queues, so it stays at the full rate.
+ */
+
+/* Enable clock_gettime and clock_nanosleep */
+#define _POSIX_C_SOURCE 200809L
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NS_PER_SEC 1000000000ll
+
+/* Adaptive pacing tuning */
+#define PACE_HEADROOM   0.8     /* Share of the drain rate frames may use */
+#define PACE_BACKOFF    0.5     /* Rate cut when output backs up */
+#define PACE_RECOVER    20.0    /* Renders to climb from the floor to the cap */
+#define PACE_SMOOTHING  0.25    /* EWMA weight of a new sample */
+
+typedef struct {
+    bool primed;                /* Baseline counters taken */
+    int64_t time;               /* When the counters were taken */
+    uint64_t encoded;
+    uint64_t frames;
+    size_t backlog;             /* Queued in termui plus the kernel tty queue */
+    double frame_bytes;         /* EWMA bytes per sent frame */
+    double drain_rate;          /* EWMA bytes/s reaching the terminal */
+} pace_t;
+
+struct termui_loop {
+    termui_buffer_t *screen;    /* Rendered after draw, may be NULL */
+    int64_t update_ns;          /* Update period */
+    int64_t render_ns;          /* Current render period */
+    double max_hz;              /* Render rate cap */
+    double min_hz;              /* Adaptive floor */
+    double hz;                  /* Current render rate */
+    bool adaptive;
+    pace_t pace;
+    int max_catchup;
+    int64_t next_update;        /* Absolute deadlines, monotonic ns */
+    int64_t next_render;
+    bool started;
+    bool pending;               /* State changed since the last draw */
+    bool running;
+    termui_loop_stats_t stats;
+};
+
+/* Monotonic clock in nanoseconds */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+/* Sleep until an absolute monotonic deadline */
+static void sleep_until(int64_t deadline) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline / NS_PER_SEC);
+    ts.tv_nsec = (long)(deadline % NS_PER_SEC);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        /* Absolute deadline - just resume after a signal */
+    }
+}
+
+static int64_t period_ns(int hz) {
+    return hz > 0 ? NS_PER_SEC / hz : NS_PER_SEC / 60;
+}
+
+termui_loop_config_t termui_loop_default_config(void) {
+    termui_loop_config_t config = {
+        .update_hz = 60,
+        .render_hz = 60,
+        .max_catchup = 5,
+        .adaptive = true,
+        .min_render_hz = 2
+    };
+    return config;
+}
+
+termui_loop_t* termui_loop_create(const termui_loop_config_t *config, termui_buffer_t *screen) {
+    termui_loop_config_t cfg = config ? *config : termui_loop_default_config();
+    if (cfg.update_hz <= 0 || cfg.render_hz <= 0) {
+        return NULL;
+    }
+
+    termui_loop_t *loop = calloc(1, sizeof(termui_loop_t));
+    if (!loop) {
+        return NULL;
+    }
+
+    loop->screen = screen;
+    loop->update_ns = period_ns(cfg.update_hz);
+    loop->render_ns = period_ns(cfg.render_hz);
+    loop->max_hz = loop->hz = (double)cfg.render_hz;
+    loop->min_hz = cfg.min_render_hz > 0 && cfg.min_render_hz < cfg.render_hz
+                 ? (double)cfg.min_render_hz : (double)cfg.render_hz;
+    loop->adaptive = cfg.adaptive;
+    loop->max_catchup = cfg.max_catchup > 0 ? cfg.max_catchup : 1;
+    loop->pending = true;  /* Draw the first frame */
+    return loop;
+}
+
+void termui_loop_destroy(termui_loop_t *loop) {
+    free(loop);
+}
+
+void termui_loop_set_screen(termui_loop_t *loop, termui_buffer_t *screen) {
+    if (!loop) return;
+
+    loop->screen = screen;
+    loop->pending = true;
+}
+
+void termui_loop_request_redraw(termui_loop_t *loop) {
+    if (!loop) return;
+
+    loop->pending = true;
+}
+
+void termui_loop_stop(termui_loop_t *loop) {
+    if (!loop) return;
+
+    loop->running = false;
+}
+
+void termui_loop_get_stats(const termui_loop_t *loop, termui_loop_stats_t *stats) {
+    if (!stats) return;
+
+    if (!loop) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = loop->stats;
+    stats->render_hz = loop->hz;
+    stats->drain_rate = loop->pace.drain_rate;
+}
+
+static double ewma(double avg, double sample) {
+    return avg > 0.0 ? avg + PACE_SMOOTHING * (sample - avg) : sample;
+}
+
+/* Retune the render rate from what the last frames cost and how fast the
+ * terminal is taking them */
+static void pace_update(termui_loop_t *loop, int64_t now) {
+    pace_t *pace = &loop->pace;
+    termui_output_stats_t out;
+    termui_output_get_stats(&out);
+    size_t backlog = out.pending_bytes + out.tty_queued_bytes;
+
+    if (pace->primed && now > pace->time) {
+        double dt = (double)(now - pace->time) / (double)NS_PER_SEC;
+        uint64_t encoded = out.bytes_encoded - pace->encoded;
+        uint64_t frames = out.frames_sent - pace->frames;
+        if (frames > 0 && encoded > 0) {
+            pace->frame_bytes = ewma(pace->frame_bytes, (double)encoded / (double)frames);
+        }
+
+        /* Only a link with a standing queue shows its capacity */
+        if (pace->backlog > 0 && backlog > 0) {
+            double drained = (double)encoded + (double)pace->backlog - (double)backlog;
+            if (drained < 0.0) drained = 0.0;
+            pace->drain_rate = ewma(pace->drain_rate, drained / dt);
+        }
+
+        double hz = loop->hz;
+        if (backlog > 0 && (double)backlog >= pace->frame_bytes) {
+            /* Over a frame queued: back off to what the link carries */
+            double target = hz * PACE_BACKOFF;
+            if (pace->drain_rate > 0.0 && pace->frame_bytes > 0.0) {
+                double fit = pace->drain_rate * PACE_HEADROOM / pace->frame_bytes;
+                if (fit < target) target = fit;
+            }
+            hz = target;
+        } else if (backlog == 0) {
+            hz += (loop->max_hz - loop->min_hz) / PACE_RECOVER;
+        }
+
+        if (hz < loop->min_hz) hz = loop->min_hz;
+        if (hz > loop->max_hz) hz = loop->max_hz;
+        loop->hz = hz;
+        loop->render_ns = (int64_t)((double)NS_PER_SEC / hz);
+    }
+
+    pace->primed = true;
+    pace->time = now;
+    pace->encoded = out.bytes_encoded;
+    pace->frames = out.frames_sent;
+    pace->backlog = backlog;
+}
+
+/* Run every update tick that is due, dropping time beyond max_catchup
+ * Returns false if update asked to stop */
+static bool run_updates(termui_loop_t *loop, termui_update_fn update, void *user, int64_t now) {
+    double dt = (double)loop->update_ns / (double)NS_PER_SEC;
+    int steps = 0;
+
+    while (now >= loop->next_update && steps < loop->max_catchup) {
+        /* Running after the following tick was already due */
+        if (now >= loop->next_update + loop->update_ns) {
+            loop->stats.missed_updates++;
+            termui_stats_note_missed(1);
+        }
+
+        loop->next_update += loop->update_ns;
+        loop->stats.updates++;
+        loop->pending = true;
+        steps++;
+
+        if (update && !update(user, dt)) {
+            return false;
+        }
+        if (!loop->running) {
+            return false;
+        }
+    }
+
+    /* Too far behind to catch up: drop the backlog */
+    if (now >= loop->next_update) {
+        int64_t behind = (now - loop->next_update) / loop->update_ns + 1;
+        loop->stats.missed_updates += (uint64_t)behind;
+        termui_stats_note_missed((uint64_t)behind);
+        loop->next_update += behind * loop->update_ns;
+    }
+    return true;
+}
+
+/* Draw and present a frame if one is due and something changed */
+static void run_render(termui_loop_t *loop, termui_draw_fn draw, void *user, int64_t now) {
+    if (now < loop->next_render) {
+        return;
+    }
+    if (!loop->pending) {
+        loop->stats.skipped_renders++;
+        loop->next_render = now;  /* Next change renders immediately */
+        return;
+    }
+
+    /* Fraction of an update period since the last tick */
+    double alpha = (double)(now - (loop->next_update - loop->update_ns)) / (double)loop->update_ns;
+    if (alpha < 0.0) alpha = 0.0;
+    if (alpha > 1.0) alpha = 1.0;
+
+    loop->pending = false;
+    if (draw) {
+        draw(user, alpha);
+    }
+
+    if (loop->screen && !termui_buffer_is_dirty(loop->screen)) {
+        loop->stats.skipped_renders++;
+    } else {
+        if (loop->screen) {
+            termui_buffer_render(loop->screen);
+        }
+        loop->stats.renders++;
+    }
+    if (loop->adaptive) {
+        pace_update(loop, now);
+    }
+
+    /* Started a whole period late: a frame was missed */
+    if (now >= loop->next_render + loop->render_ns) {
+        loop->stats.missed_renders++;
+        termui_stats_note_missed(1);
+        loop->next_render = now;
+    }
+    loop->next_render += loop->render_ns;
+}
+
+bool termui_loop_step(termui_loop_t *loop, termui_update_fn update, termui_draw_fn draw, void *user) {
+    if (!loop) return false;
+
+    if (!loop->started) {
+        int64_t now = now_ns();
+        loop->next_update = now;
+        loop->next_render = now;
+        loop->started = true;
+        loop->running = true;
+    }
+    if (!loop->running) {
+        return false;
+    }
+
+    /* Renders are only due once something is pending */
+    int64_t deadline = loop->next_update;
+    if (loop->pending && loop->next_render < deadline) {
+        deadline = loop->next_render;
+    }
+
+    int64_t now = now_ns();
+    if (now < deadline) {
+        sleep_until(deadline);
+        now = now_ns();
+    }
+
+    if (!run_updates(loop, update, user, now)) {
+        loop->running = false;
+        return false;
+    }
+    run_render(loop, draw, user, now);
+    return loop->running;
+}
+
+int termui_loop_run(termui_loop_t *loop, termui_update_fn update, termui_draw_fn draw, void *user) {
+    if (!loop) return TERMUI_INVALID;
+
+    loop->started = false;
+    while (termui_loop_step(loop, update, draw, user)) {
+        /* Step sleeps until the next deadline */
+    }
+    return TERMUI_OK;
+}
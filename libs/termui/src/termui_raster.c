@@ -0,0 +1,250 @@
+/*
+ * termui - Shape Rasterizers
+ *
+ * Integer-only lines, polylines, circles and filled polygons, shared by
+ * buffers (one cell per pixel) and canvases (sub-cell pixels). Shapes
+ * are clipped against the target rectangle before any pixel is visited
+ * and reach the target as horizontal spans, so the target never checks
+ * bounds and off-screen parts of a shape cost nothing.
+ *
+ * Lines are Bresenham's, clipped Cohen-Sutherland style: outcodes accept
+ * or reject most lines outright, and the rest are clipped in the step
+ * parameter of the line rather than by moving its endpoints, so a
+ * clipped line covers exactly the pixels of the unclipped one.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <stdlib.h>
+
+/* Outcode bits */
+#define OUT_LEFT   1
+#define OUT_RIGHT  2
+#define OUT_TOP    4
+#define OUT_BOTTOM 8
+
+static int outcode(const termui_raster_t *r, int x, int y) {
+    int code = 0;
+    if (x < 0) code |= OUT_LEFT;
+    else if (x >= r->width) code |= OUT_RIGHT;
+    if (y < 0) code |= OUT_TOP;
+    else if (y >= r->height) code |= OUT_BOTTOM;
+    return code;
+}
+
+/* Floor and ceiling of a / b for b > 0 */
+static int64_t floor_div(int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int64_t ceil_div(int64_t a, int64_t b) {
+    return -floor_div(-a, b);
+}
+
+/* Steps k for which p + s * k (s = +1 or -1) lies in [0, size) */
+static void axis_range(int p, int s, int size, int64_t *kmin, int64_t *kmax) {
+    if (s > 0) {
+        *kmin = -(int64_t)p;
+        *kmax = (int64_t)size - 1 - p;
+    } else {
+        *kmin = (int64_t)p - (size - 1);
+        *kmax = p;
+    }
+}
+
+void termui_raster_line(const termui_raster_t *r, int x0, int y0, int x1, int y1) {
+    int code0 = outcode(r, x0, y0);
+    int code1 = outcode(r, x1, y1);
+    if (code0 & code1) {
+        return;  /* Both ends beyond the same edge */
+    }
+
+    /* Step along the major axis; the minor coordinate after k steps is
+     * floor((2k * dmin + dmaj) / (2 * dmaj)) from the start */
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    bool steep = dy > dx;
+    int maj0 = steep ? y0 : x0, min0 = steep ? x0 : y0;
+    int smaj = (steep ? y1 > y0 : x1 > x0) ? 1 : -1;
+    int smin = (steep ? x1 > x0 : y1 > y0) ? 1 : -1;
+    int64_t dmaj = steep ? dy : dx;
+    int64_t dmin = steep ? dx : dy;
+    int maj_size = steep ? r->height : r->width;
+    int min_size = steep ? r->width : r->height;
+
+    int64_t first = 0;
+    int64_t last = dmaj;
+    if (code0 | code1) {
+        int64_t lo, hi;
+        axis_range(maj0, smaj, maj_size, &lo, &hi);
+        if (lo > first) first = lo;
+        if (hi < last) last = hi;
+
+        /* Minor offsets q that stay inside, then the steps giving them */
+        int64_t qlo, qhi;
+        axis_range(min0, smin, min_size, &qlo, &qhi);
+        if (qlo < 0) qlo = 0;
+        if (qhi > dmin) qhi = dmin;
+        if (qlo > qhi) return;
+        if (dmin > 0) {
+            lo = ceil_div(2 * dmaj * qlo - dmaj, 2 * dmin);
+            hi = ceil_div(2 * dmaj * (qhi + 1) - dmaj, 2 * dmin) - 1;
+            if (lo > first) first = lo;
+            if (hi < last) last = hi;
+        }
+        if (first > last) return;
+    }
+
+    int64_t num = 2 * first * dmin + dmaj;
+    int maj = maj0 + smaj * (int)first;
+    int min = min0 + smin * (int)(dmaj > 0 ? num / (2 * dmaj) : 0);
+    int64_t err = dmaj > 0 ? num % (2 * dmaj) : 0;
+    int64_t steps = last - first;
+
+    if (steep) {
+        for (int64_t k = 0; k <= steps; k++) {
+            r->span(r->target, min, maj, 1);
+            maj += smaj;
+            err += 2 * dmin;
+            if (err >= 2 * dmaj) {
+                err -= 2 * dmaj;
+                min += smin;
+            }
+        }
+        return;
+    }
+
+    /* Shallow: one span per row */
+    int start = maj;
+    for (int64_t k = 0; k <= steps; k++) {
+        bool end = k == steps;
+        err += 2 * dmin;
+        if (!end && err < 2 * dmaj) {
+            maj += smaj;
+            continue;
+        }
+        r->span(r->target, smaj > 0 ? start : maj, min, abs(maj - start) + 1);
+        err -= 2 * dmaj;
+        maj += smaj;
+        min += smin;
+        start = maj;
+    }
+}
+
+void termui_raster_polyline(const termui_raster_t *r, const termui_point_t *points, int count) {
+    if (count == 1) {
+        termui_raster_line(r, points[0].x, points[0].y, points[0].x, points[0].y);
+    }
+    for (int i = 1; i < count; i++) {
+        termui_raster_line(r, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
+    }
+}
+
+/* One circle pixel, for circles that cross the edge */
+static void clipped_pixel(const termui_raster_t *r, int x, int y) {
+    if (x >= 0 && x < r->width && y >= 0 && y < r->height) {
+        r->span(r->target, x, y, 1);
+    }
+}
+
+void termui_raster_circle(const termui_raster_t *r, int cx, int cy, int radius) {
+    if (radius < 0) return;
+
+    /* Bounding box outside: nothing; inside: no per-pixel checks */
+    int64_t left = (int64_t)cx - radius, right = (int64_t)cx + radius;
+    int64_t top = (int64_t)cy - radius, bottom = (int64_t)cy + radius;
+    if (right < 0 || bottom < 0 || left >= r->width || top >= r->height) {
+        return;
+    }
+    bool inside = left >= 0 && top >= 0 && right < r->width && bottom < r->height;
+
+    /* Midpoint circle, one octant mirrored eight ways */
+    int x = radius;
+    int y = 0;
+    int err = 1 - radius;
+    while (x >= y) {
+        int px[8] = { cx + x, cx - x, cx + x, cx - x, cx + y, cx - y, cx + y, cx - y };
+        int py[8] = { cy + y, cy + y, cy - y, cy - y, cy + x, cy + x, cy - x, cy - x };
+        for (int i = 0; i < 8; i++) {
+            if (inside) {
+                r->span(r->target, px[i], py[i], 1);
+            } else {
+                clipped_pixel(r, px[i], py[i]);
+            }
+        }
+
+        y++;
+        if (err < 0) {
+            err += 2 * y + 1;
+        } else {
+            x--;
+            err += 2 * (y - x) + 1;
+        }
+    }
+}
+
+/* Sort a few scanline crossings */
+static void sort_crossings(int *xs, int n) {
+    for (int i = 1; i < n; i++) {
+        int v = xs[i];
+        int j = i - 1;
+        while (j >= 0 && xs[j] > v) {
+            xs[j + 1] = xs[j];
+            j--;
+        }
+        xs[j + 1] = v;
+    }
+}
+
+void termui_raster_polygon(const termui_raster_t *r, const termui_point_t *points, int count) {
+    if (count <= 0) return;
+
+    int ymin = points[0].y, ymax = points[0].y;
+    for (int i = 1; i < count; i++) {
+        if (points[i].y < ymin) ymin = points[i].y;
+        if (points[i].y > ymax) ymax = points[i].y;
+    }
+
+    /* Interior by even-odd scanlines over the visible rows only */
+    int y0 = ymin < 0 ? 0 : ymin;
+    int y1 = ymax >= r->height ? r->height - 1 : ymax;
+    int stack[32];
+    int *xs = count <= 32 ? stack : malloc((size_t)count * sizeof(int));
+    if (xs) {
+        for (int y = y0; y <= y1; y++) {
+            int n = 0;
+            for (int i = 0; i < count; i++) {
+                termui_point_t a = points[i];
+                termui_point_t b = points[(i + 1) % count];
+                if (a.y > b.y) {
+                    termui_point_t t = a;
+                    a = b;
+                    b = t;
+                }
+                /* Half-open in y, so shared vertices count once */
+                if (y < a.y || y >= b.y) continue;
+
+                int64_t dy = b.y - a.y;
+                xs[n++] = a.x + (int)floor_div(2 * (int64_t)(y - a.y) * (b.x - a.x) + dy, 2 * dy);
+            }
+
+            sort_crossings(xs, n);
+            for (int i = 0; i + 1 < n; i += 2) {
+                int xa = xs[i] < 0 ? 0 : xs[i];
+                int xb = xs[i + 1] >= r->width ? r->width - 1 : xs[i + 1];
+                if (xa <= xb) {
+                    r->span(r->target, xa, y, xb - xa + 1);
+                }
+            }
+        }
+        if (xs != stack) {
+            free(xs);
+        }
+    }
+
+    /* The outline covers the edge pixels the half-open rule leaves out */
+    termui_raster_polyline(r, points, count);
+    if (count > 2) {
+        termui_raster_line(r, points[count - 1].x, points[count - 1].y, points[0].x, points[0].y);
+    }
+}
@@ -0,0 +1,566 @@
+/*
+ * termui - Frame Presentation
+ *
+ * Compares the dirty spans of a buffer against the frame it last
+ * presented and hands each run of changed cells to the active backend:
+ * ncurses, or the direct ANSI encoder in termui_ansi.c.
+ *
+ * Before diffing, rows that moved vertically as a block (log tails,
+ * scrolling starfields) are detected by row hash and replayed as a
+ * terminal scroll region, so only the newly exposed lines are sent.
+ *
+ * With the ANSI backend, a frame rendered while the previous one is
+ * still queued for the terminal replaces it if not a byte of it has been
+ * written: the cells the queued frame changed are marked unknown in the
+ * presented copy, so the new frame is one fresh diff against what the
+ * terminal actually has. A frame already partly written must complete,
+ * and the new one is deferred untouched until it has; its damage and
+ * the presented copy stay as they were, so it too goes out as one diff.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <ncurses.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Largest vertical shift searched for */
+#define SCROLL_MAX_SHIFT 16
+
+/* Changed rows a scroll must fix before it beats plain repainting */
+#define SCROLL_MIN_GAIN 3
+
+/* Scroll regions detected per frame */
+#define SCROLL_MAX_REGIONS 4
+
+/* Row states for scroll detection */
+#define ROW_CHANGED 1u   /* Differs from the presented row */
+#define ROW_USED    2u   /* Already part of a scroll region this frame */
+
+/* Newest frame deferred by backpressure, rendered once output drains */
+static const termui_buffer_t *g_deferred = NULL;
+static uint64_t g_frames_sent = 0;
+static uint64_t g_frames_deferred = 0;
+static uint64_t g_frames_replaced = 0;
+
+/* What the last encoded frame changed in its buffer's presented copy,
+ * to undo if the frame is dropped unsent */
+static const termui_buffer_t *g_queued = NULL;  /* NULL if not tracked */
+static bool g_queued_full = false;  /* Whole screen repainted */
+static int *g_queued_lo = NULL;     /* Per row changed span */
+static int *g_queued_hi = NULL;
+static int g_queued_rows = 0;       /* Rows allocated */
+static int g_queued_height = 0;     /* Rows the spans are for */
+
+/* Map a glyph to a narrow-ncurses character
+ * Box drawing becomes the matching ACS line character; other non-ASCII
+ * glyphs, which ncurses cannot print without wide-char support, show as
+ * '?' per cell. Full Unicode output needs the ANSI backend. */
+static chtype curses_glyph(unsigned int glyph) {
+    if (glyph < TERMUI_GLYPH_FIRST) {
+        return glyph < 0x20 || glyph == 0x7f ? '?' : glyph;
+    }
+    if (glyph == TERMUI_GLYPH_CONT) {
+        return ' ';
+    }
+
+    switch (termui_glyph_codepoint(glyph)) {
+        case 0x2500: case 0x2501: case 0x2550:
+            return ACS_HLINE;
+        case 0x2502: case 0x2503: case 0x2551:
+            return ACS_VLINE;
+        case 0x250c: case 0x250f: case 0x2554: case 0x256d:
+            return ACS_ULCORNER;
+        case 0x2510: case 0x2513: case 0x2557: case 0x256e:
+            return ACS_URCORNER;
+        case 0x2514: case 0x2517: case 0x255a: case 0x2570:
+            return ACS_LLCORNER;
+        case 0x2518: case 0x251b: case 0x255d: case 0x256f:
+            return ACS_LRCORNER;
+        case 0x251c: return ACS_LTEE;
+        case 0x2524: return ACS_RTEE;
+        case 0x252c: return ACS_TTEE;
+        case 0x2534: return ACS_BTEE;
+        case 0x253c: return ACS_PLUS;
+        default:     return '?';
+    }
+}
+
+/* ncurses attributes of a style: the nearest basic color pair, bright
+ * colors as bold */
+static attr_t curses_attrs(unsigned int id, bool colors) {
+    const termui_style_t *style = termui_style_get(id);
+    attr_t attrs = A_NORMAL;
+
+    if (colors) {
+        bool bright;
+        termui_color_t color = termui_xcolor_basic(style->fg, &bright);
+        if (color > TERMUI_COLOR_DEFAULT) {
+            attrs |= COLOR_PAIR(color);
+        }
+        if (bright) {
+            attrs |= A_BOLD;
+        }
+    }
+    if (style->attrs & TERMUI_ATTR_BOLD) attrs |= A_BOLD;
+    if (style->attrs & TERMUI_ATTR_UNDERLINE) attrs |= A_UNDERLINE;
+    if (style->attrs & TERMUI_ATTR_REVERSE) attrs |= A_REVERSE;
+    return attrs;
+}
+
+/* Send cells [x0, x1) of row y through ncurses,
+ * switching attributes only when the style changes */
+static void curses_run(const termui_buffer_t *buf, int y, int x0, int x1, bool colors) {
+    const termui_cell_t *cells = buf->cells + (size_t)y * (size_t)buf->width;
+    unsigned int pen = 0;
+
+    move(y, x0);
+    for (int x = x0; x < x1; x++) {
+        unsigned int style = termui_cell_style(cells[x]);
+        if (style != pen) {
+            attrset(curses_attrs(style, colors));
+            pen = style;
+        }
+        addch(curses_glyph(termui_cell_glyph(cells[x])));
+    }
+
+    if (pen != 0) {
+        attrset(A_NORMAL);
+    }
+}
+
+static uint64_t hash_row(const termui_cell_t *cells, int width) {
+    uint64_t h = 14695981039346656037ull;
+    for (int x = 0; x < width; x++) {
+        h = (h ^ cells[x]) * 1099511628211ull;
+    }
+    return h;
+}
+
+/* Scroll rows [top, bottom] of the terminal by n lines (up if positive) */
+static void curses_scroll(int top, int bottom, int n) {
+    int lines, cols;
+    getmaxyx(stdscr, lines, cols);
+    (void)cols;
+
+    /* scrollok only for the duration: left on, writing the bottom-right
+     * cell would scroll the whole screen */
+    scrollok(stdscr, TRUE);
+    setscrreg(top, bottom);
+    scrl(n);
+    setscrreg(0, lines - 1);
+    scrollok(stdscr, FALSE);
+}
+
+/* Start tracking a frame of buf; false (untracked) if out of memory */
+static bool queue_begin(const termui_buffer_t *buf, bool full) {
+    g_queued = NULL;
+    if (buf->height > g_queued_rows) {
+        int *lo = realloc(g_queued_lo, (size_t)buf->height * sizeof(int));
+        if (!lo) return false;
+        g_queued_lo = lo;
+        int *hi = realloc(g_queued_hi, (size_t)buf->height * sizeof(int));
+        if (!hi) return false;
+        g_queued_hi = hi;
+        g_queued_rows = buf->height;
+    }
+
+    for (int y = 0; y < buf->height; y++) {
+        g_queued_lo[y] = buf->width;
+        g_queued_hi[y] = 0;
+    }
+    g_queued = buf;
+    g_queued_full = full;
+    g_queued_height = buf->height;
+    return true;
+}
+
+/* Note that the frame changed presented cells [x0, x1) of row y */
+static void queue_note(int y, int x0, int x1) {
+    if (!g_queued) return;
+    if (x0 < g_queued_lo[y]) g_queued_lo[y] = x0;
+    if (x1 > g_queued_hi[y]) g_queued_hi[y] = x1;
+}
+
+/* The queued frame of buf was dropped unsent: the cells it changed are
+ * unknown again, and damaged so the next frame sends them */
+static void queue_undo(const termui_buffer_t *buf) {
+    struct termui_front *f = buf->front;
+    g_queued = NULL;
+    if (g_queued_full) {
+        f->valid = false;
+        return;
+    }
+
+    int height = g_queued_height < buf->height ? g_queued_height : buf->height;
+    for (int y = 0; y < height; y++) {
+        int lo = g_queued_lo[y];
+        int hi = g_queued_hi[y] < buf->width ? g_queued_hi[y] : buf->width;
+        if (lo >= hi) continue;
+
+        termui_cells_fill(f->cells + (size_t)y * (size_t)buf->width + (size_t)lo,
+                          TERMUI_CELL_UNKNOWN, (size_t)(hi - lo));
+        if (lo < f->dirty_lo[y]) f->dirty_lo[y] = lo;
+        if (hi > f->dirty_hi[y]) f->dirty_hi[y] = hi;
+        f->dirty = true;
+    }
+}
+
+/* Find blocks of rows that moved vertically since the last present and
+ * scroll the terminal to match. The presented copy is shifted the same
+ * way, so the normal diff afterwards only sees exposed and edited rows.
+ * A terminal scroll moves whole lines, so a buffer narrower or wider
+ * than the terminal is left to the diff. Returns true if anything was
+ * sent. */
+static bool present_scrolls(const termui_buffer_t *buf, bool ansi) {
+    struct termui_front *f = buf->front;
+    int w = buf->width;
+    int h = buf->height;
+    uint64_t *back_hash = f->row_hash;
+    uint64_t *front_hash = f->row_hash + h;
+    unsigned char *state = f->row_state;
+
+    /* Only worth hashing when several rows changed */
+    int changed = 0;
+    for (int y = 0; y < h; y++) {
+        state[y] = 0;
+        int lo = f->dirty_lo[y];
+        int hi = f->dirty_hi[y];
+        size_t row = (size_t)y * (size_t)w + (size_t)lo;
+        size_t first, last;
+        if (lo < hi && termui_cells_diff(buf->cells + row, f->cells + row, (size_t)(hi - lo), &first, &last)) {
+            state[y] = ROW_CHANGED;
+            changed++;
+        }
+    }
+    if (changed < SCROLL_MIN_GAIN) {
+        return false;
+    }
+
+    int screen_width;
+    termui_get_size(&screen_width, NULL);
+    if (w != screen_width) {
+        return false;
+    }
+
+    for (int y = 0; y < h; y++) {
+        back_hash[y] = hash_row(buf->cells + (size_t)y * (size_t)w, w);
+        front_hash[y] = hash_row(f->cells + (size_t)y * (size_t)w, w);
+    }
+
+    bool sent = false;
+    for (int pass = 0; pass < SCROLL_MAX_REGIONS; pass++) {
+        int best_gain = 0, best_shift = 0, best_r0 = 0, best_r1 = 0;
+        int max_shift = h / 2 < SCROLL_MAX_SHIFT ? h / 2 : SCROLL_MAX_SHIFT;
+
+        /* Back row r shows what front row r + k showed (k > 0: moved up) */
+        for (int k = -max_shift; k <= max_shift; k++) {
+            if (k == 0) continue;
+
+            int run_start = -1, gain = 0;
+            for (int r = 0; r <= h; r++) {
+                int src = r + k;
+                bool match = r < h && src >= 0 && src < h &&
+                             !(state[r] & ROW_USED) && !(state[src] & ROW_USED) &&
+                             back_hash[r] == front_hash[src] &&
+                             memcmp(buf->cells + (size_t)r * (size_t)w,
+                                    f->cells + (size_t)src * (size_t)w,
+                                    (size_t)w * sizeof(termui_cell_t)) == 0;
+                if (match) {
+                    if (run_start < 0) {
+                        run_start = r;
+                        gain = 0;
+                    }
+                    if (state[r] & ROW_CHANGED) gain++;
+                    continue;
+                }
+                if (run_start >= 0 && gain > best_gain) {
+                    best_gain = gain;
+                    best_shift = k;
+                    best_r0 = run_start;
+                    best_r1 = r - 1;
+                }
+                run_start = -1;
+            }
+        }
+
+        if (best_gain < SCROLL_MIN_GAIN) {
+            break;
+        }
+
+        /* Region covers the matched rows plus the rows they came from */
+        int k = best_shift;
+        int top = k > 0 ? best_r0 : best_r0 + k;
+        int bottom = k > 0 ? best_r1 + k : best_r1;
+        int n = k > 0 ? k : -k;
+
+        if (ansi) {
+            termui_ansi_frame_scroll(top, bottom, k);
+        } else {
+            curses_scroll(top, bottom, k);
+        }
+        sent = true;
+
+        /* Shift the presented copy and blank the exposed lines */
+        termui_cell_t *region = f->cells + (size_t)top * (size_t)w;
+        size_t keep = (size_t)(bottom - top + 1 - n) * (size_t)w;
+        int exposed = k > 0 ? bottom - n + 1 : top;
+        if (k > 0) {
+            memmove(region, region + (size_t)n * (size_t)w, keep * sizeof(termui_cell_t));
+        } else {
+            memmove(region + (size_t)n * (size_t)w, region, keep * sizeof(termui_cell_t));
+        }
+        termui_cells_fill(f->cells + (size_t)exposed * (size_t)w, TERMUI_CELL_BLANK,
+                          (size_t)n * (size_t)w);
+
+        for (int y = top; y <= bottom; y++) {
+            state[y] |= ROW_USED;
+            if (ansi) {
+                queue_note(y, 0, w);
+            }
+        }
+        for (int y = exposed; y < exposed + n; y++) {
+            f->dirty_lo[y] = 0;
+            f->dirty_hi[y] = w;
+        }
+    }
+
+    return sent;
+}
+
+/* Present buf; called with the output lock held */
+static void render_locked(const termui_buffer_t *buf) {
+    struct termui_front *f = buf->front;
+    termui_tiles_collect(buf);
+
+    /* Anything else presented since our last frame invalidates the copy */
+    if (f->valid && f->epoch != termui_screen_epoch()) {
+        f->valid = false;
+    }
+
+    if (f->valid && !f->dirty) {
+        return;  /* Identical frame - nothing to send */
+    }
+
+    bool full = !f->valid;
+    bool ansi = termui_backend_encodes();
+    bool colors = termui_colors_active();
+    bool sent = false;
+    uint32_t cells_sent = 0;
+
+    /* Terminal still draining the last frame: replace it if none of it
+     * went out, else keep the damage for later */
+    if (ansi && termui_ansi_pending() > 0) {
+        if (g_queued != buf || !termui_ansi_frame_drop()) {
+            g_deferred = buf;
+            g_frames_deferred++;
+            return;
+        }
+        queue_undo(buf);
+        g_frames_replaced++;
+        full = !f->valid;
+    }
+    if (g_deferred == buf) {
+        g_deferred = NULL;
+    }
+
+    /* Frame timing only while stats are enabled */
+    bool timed = termui_stats_active();
+    uint64_t began = timed ? termui_stats_clock() : 0;
+    if (ansi) {
+        termui_ansi_frame_begin();
+        queue_begin(buf, full);
+    }
+
+    if (!full && present_scrolls(buf, ansi)) {
+        sent = true;
+    }
+
+    for (int y = 0; y < buf->height; y++) {
+        int lo = full ? 0 : f->dirty_lo[y];
+        int hi = full ? buf->width : f->dirty_hi[y];
+        if (lo >= hi) continue;
+
+        size_t row = (size_t)y * (size_t)buf->width;
+        const termui_cell_t *cells = buf->cells + row;
+        termui_cell_t *fcells = f->cells + row;
+
+        /* Narrow the span to its first and last changed cell */
+        if (!full) {
+            size_t first, last;
+            if (!termui_cells_diff(cells + lo, fcells + lo, (size_t)(hi - lo), &first, &last)) {
+                continue;
+            }
+            hi = lo + (int)last + 1;
+            lo += (int)first;
+        }
+
+        /* Emit each maximal run of changed cells */
+        int x = lo;
+        while (x < hi) {
+            if (!full && cells[x] == fcells[x]) {
+                x++;
+                continue;
+            }
+
+            int start = x;
+            while (x < hi && (full || cells[x] != fcells[x])) {
+                x++;
+            }
+
+            /* Never split a double-width glyph across runs */
+            if (start > 0 && termui_cell_glyph(cells[start]) == TERMUI_GLYPH_CONT) {
+                start--;
+            }
+            if (x < buf->width && termui_cell_glyph(cells[x]) == TERMUI_GLYPH_CONT) {
+                x++;
+            }
+
+            if (ansi) {
+                termui_ansi_frame_run(buf, y, start, x);
+            } else {
+                curses_run(buf, y, start, x, colors);
+            }
+            cells_sent += (uint32_t)(x - start);
+            sent = true;
+        }
+
+        memcpy(fcells + lo, cells + lo, (size_t)(hi - lo) * sizeof(termui_cell_t));
+        if (ansi) {
+            queue_note(y, lo, hi);
+        }
+    }
+
+    termui_buffer_clear_dirty(buf);
+    f->valid = true;
+
+    if (ansi && !termui_ansi_frame_end()) {
+        f->valid = false;  /* Out of memory: nothing went out, repaint in full */
+        g_queued = NULL;
+        sent = false;
+    } else if (!ansi && sent) {
+        refresh();
+    }
+    if (sent) {
+        g_frames_sent++;
+        if (timed) {
+            termui_stats_record_frame(termui_stats_clock() - began, cells_sent);
+        }
+    }
+    f->epoch = termui_screen_touch();
+}
+
+void termui_buffer_render(const termui_buffer_t *buf) {
+    if (!buf || buf->view || !termui_is_initialized()) return;
+
+    termui_output_lock();
+    render_locked(buf);
+    termui_output_unlock();
+}
+
+void termui_buffer_render_locked(const termui_buffer_t *buf) {
+    render_locked(buf);
+}
+
+void termui_render_forget(const termui_buffer_t *buf) {
+    termui_output_lock();
+    if (g_deferred == buf) {
+        g_deferred = NULL;
+    }
+    if (g_queued == buf) {
+        g_queued = NULL;
+    }
+    termui_output_unlock();
+}
+
+int termui_output_poll_fd(void) {
+    if (!termui_is_initialized() || !termui_backend_encodes()) {
+        return -1;
+    }
+
+    termui_output_lock();
+    int fd = termui_ansi_pending() > 0 ? termui_ansi_out_fd() : -1;
+    termui_output_unlock();
+    return fd;
+}
+
+void termui_output_service(void) {
+    if (!termui_is_initialized() || !termui_backend_encodes()) {
+        return;
+    }
+
+    termui_output_lock();
+    if (termui_ansi_pending() == 0 && g_deferred) {
+        const termui_buffer_t *buf = g_deferred;
+        render_locked(buf);
+    }
+    termui_output_unlock();
+}
+
+size_t termui_output_pending(void) {
+    if (!termui_is_initialized() || !termui_backend_encodes()) {
+        return 0;
+    }
+
+    termui_output_lock();
+    size_t pending = termui_ansi_pending();
+    termui_output_unlock();
+    return pending;
+}
+
+bool termui_output_flush(int timeout_ms) {
+    if (!termui_is_initialized() || !termui_backend_encodes()) {
+        return true;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (;;) {
+        termui_output_service();
+
+        termui_output_lock();
+        bool done = termui_ansi_pending() == 0 && !g_deferred;
+        int fd = termui_ansi_out_fd();
+        termui_output_unlock();
+        if (done) {
+            return true;
+        }
+
+        int wait = -1;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long elapsed = (long)(now.tv_sec - start.tv_sec) * 1000 +
+                           (now.tv_nsec - start.tv_nsec) / 1000000;
+            if (elapsed >= timeout_ms) {
+                return false;
+            }
+            wait = timeout_ms - (int)elapsed;
+        }
+
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+        if (poll(&pfd, 1, wait) < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+void termui_output_get_stats(termui_output_stats_t *stats) {
+    if (!stats) return;
+
+    termui_output_lock();
+    bool ansi = termui_is_initialized() && termui_backend_encodes();
+    stats->pending_bytes = ansi ? termui_ansi_pending() : 0;
+    stats->tty_queued_bytes = ansi ? termui_ansi_tty_queue() : 0;
+    stats->bytes_encoded = ansi ? termui_ansi_bytes_encoded() : 0;
+    stats->bytes_written = ansi ? termui_ansi_bytes_written() : 0;
+    stats->write_calls = ansi ? termui_ansi_write_calls() : 0;
+    stats->frames_sent = g_frames_sent;
+    stats->frames_deferred = g_frames_deferred;
+    stats->frames_replaced = g_frames_replaced;
+    termui_output_unlock();
+}
@@ -0,0 +1,266 @@
+/*
+ * termui - Cell Kernels
+ *
+ * Bulk operations on packed cells. Each kernel has a portable scalar
+ * version plus SSE2 and AVX2 versions on x86; the widest one the CPU
+ * supports is picked on first use. Setting TERMUI_SIMD=scalar, sse2 or
+ * avx2 in the environment caps the choice (useful for testing).
+ *
+ * Tiles let several threads fill and diff at once, so the first use is
+ * resolved under pthread_once and the kernel pointers are read and
+ * written atomically.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TERMUI_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+typedef void (*fill_fn)(termui_cell_t *dst, termui_cell_t value, size_t n);
+typedef bool (*diff_fn)(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                        size_t *first, size_t *last);
+
+static void fill_resolve(termui_cell_t *dst, termui_cell_t value, size_t n);
+static bool diff_resolve(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                         size_t *first, size_t *last);
+
+static fill_fn g_fill = fill_resolve;     /* Accessed atomically */
+static diff_fn g_diff = diff_resolve;     /* Accessed atomically */
+static termui_simd_level_t g_level = TERMUI_SIMD_SCALAR;
+static pthread_once_t g_resolve_once = PTHREAD_ONCE_INIT;
+
+static void fill_scalar(termui_cell_t *dst, termui_cell_t value, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = value;
+    }
+}
+
+static bool diff_scalar(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                        size_t *first, size_t *last) {
+    size_t lo = 0;
+    while (lo < n && a[lo] == b[lo]) {
+        lo++;
+    }
+    if (lo == n) {
+        return false;
+    }
+
+    size_t hi = n - 1;
+    while (a[hi] == b[hi]) {
+        hi--;
+    }
+
+    *first = lo;
+    *last = hi;
+    return true;
+}
+
+#ifdef TERMUI_HAVE_X86_SIMD
+
+__attribute__((target("sse2")))
+static void fill_sse2(termui_cell_t *dst, termui_cell_t value, size_t n) {
+    __m128i v = _mm_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+        _mm_storeu_si128((__m128i *)(dst + i + 4), v);
+    }
+    if (i + 4 <= n) {
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+        i += 4;
+    }
+    for (; i < n; i++) {
+        dst[i] = value;
+    }
+}
+
+__attribute__((target("avx2")))
+static void fill_avx2(termui_cell_t *dst, termui_cell_t value, size_t n) {
+    __m256i v = _mm256_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+        _mm256_storeu_si256((__m256i *)(dst + i + 8), v);
+    }
+    if (i + 8 <= n) {
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+        i += 8;
+    }
+    for (; i < n; i++) {
+        dst[i] = value;
+    }
+}
+
+/* Each kernel scans forward for the first block with a mismatch, then
+ * backward from the end for the last one. movemask yields 4 bits per
+ * 32-bit lane, so the lane index is the bit index divided by 4. */
+
+__attribute__((target("sse2")))
+static bool diff_sse2(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                      size_t *first, size_t *last) {
+    size_t lo = 0;
+    for (;;) {
+        if (lo + 4 > n) {
+            while (lo < n && a[lo] == b[lo]) lo++;
+            if (lo == n) return false;
+            break;
+        }
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(a + lo)),
+                                     _mm_loadu_si128((const __m128i *)(b + lo)));
+        unsigned int ne = ~(unsigned int)_mm_movemask_epi8(eq) & 0xffffu;
+        if (ne) {
+            lo += (size_t)__builtin_ctz(ne) / 4;
+            break;
+        }
+        lo += 4;
+    }
+
+    /* A mismatch exists at lo, so the backward scan stops at or after it */
+    size_t hi = n;
+    while (hi >= lo + 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(a + hi - 4)),
+                                     _mm_loadu_si128((const __m128i *)(b + hi - 4)));
+        unsigned int ne = ~(unsigned int)_mm_movemask_epi8(eq) & 0xffffu;
+        if (ne) {
+            *first = lo;
+            *last = hi - 4 + (size_t)(31 - __builtin_clz(ne)) / 4;
+            return true;
+        }
+        hi -= 4;
+    }
+    do {
+        hi--;
+    } while (a[hi] == b[hi]);
+
+    *first = lo;
+    *last = hi;
+    return true;
+}
+
+__attribute__((target("avx2")))
+static bool diff_avx2(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                      size_t *first, size_t *last) {
+    size_t lo = 0;
+    for (;;) {
+        if (lo + 8 > n) {
+            while (lo < n && a[lo] == b[lo]) lo++;
+            if (lo == n) return false;
+            break;
+        }
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(a + lo)),
+                                        _mm256_loadu_si256((const __m256i *)(b + lo)));
+        unsigned int ne = ~(unsigned int)_mm256_movemask_epi8(eq);
+        if (ne) {
+            lo += (size_t)__builtin_ctz(ne) / 4;
+            break;
+        }
+        lo += 8;
+    }
+
+    size_t hi = n;
+    while (hi >= lo + 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(a + hi - 8)),
+                                        _mm256_loadu_si256((const __m256i *)(b + hi - 8)));
+        unsigned int ne = ~(unsigned int)_mm256_movemask_epi8(eq);
+        if (ne) {
+            *first = lo;
+            *last = hi - 8 + (size_t)(31 - __builtin_clz(ne)) / 4;
+            return true;
+        }
+        hi -= 8;
+    }
+    do {
+        hi--;
+    } while (a[hi] == b[hi]);
+
+    *first = lo;
+    *last = hi;
+    return true;
+}
+
+#endif /* TERMUI_HAVE_X86_SIMD */
+
+/* Pick the widest supported level, capped by TERMUI_SIMD */
+static void resolve(void) {
+    termui_simd_level_t level = TERMUI_SIMD_SCALAR;
+
+#ifdef TERMUI_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        level = TERMUI_SIMD_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        level = TERMUI_SIMD_SSE2;
+    }
+#endif
+
+    const char *cap = getenv("TERMUI_SIMD");
+    if (cap) {
+        termui_simd_level_t max = level;
+        if (strcmp(cap, "scalar") == 0) max = TERMUI_SIMD_SCALAR;
+        else if (strcmp(cap, "sse2") == 0) max = TERMUI_SIMD_SSE2;
+        else if (strcmp(cap, "avx2") == 0) max = TERMUI_SIMD_AVX2;
+        if (max < level) level = max;
+    }
+
+    fill_fn fill = fill_scalar;
+    diff_fn diff = diff_scalar;
+#ifdef TERMUI_HAVE_X86_SIMD
+    if (level == TERMUI_SIMD_AVX2) {
+        fill = fill_avx2;
+        diff = diff_avx2;
+    } else if (level == TERMUI_SIMD_SSE2) {
+        fill = fill_sse2;
+        diff = diff_sse2;
+    }
+#endif
+    g_level = level;
+    __atomic_store_n(&g_fill, fill, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_diff, diff, __ATOMIC_RELEASE);
+}
+
+static void fill_resolve(termui_cell_t *dst, termui_cell_t value, size_t n) {
+    pthread_once(&g_resolve_once, resolve);
+    __atomic_load_n(&g_fill, __ATOMIC_ACQUIRE)(dst, value, n);
+}
+
+static bool diff_resolve(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                         size_t *first, size_t *last) {
+    pthread_once(&g_resolve_once, resolve);
+    return __atomic_load_n(&g_diff, __ATOMIC_ACQUIRE)(a, b, n, first, last);
+}
+
+termui_simd_level_t termui_simd_level(void) {
+    pthread_once(&g_resolve_once, resolve);
+    return g_level;
+}
+
+void termui_cells_fill(termui_cell_t *dst, termui_cell_t value, size_t n) {
+    __atomic_load_n(&g_fill, __ATOMIC_ACQUIRE)(dst, value, n);
+}
+
+void termui_cells_fill_rect(termui_cell_t *dst, size_t stride, size_t width,
+                            size_t height, termui_cell_t value) {
+    if (width == stride) {
+        /* Contiguous rows - one span */
+        __atomic_load_n(&g_fill, __ATOMIC_ACQUIRE)(dst, value, width * height);
+        return;
+    }
+    fill_fn fill = __atomic_load_n(&g_fill, __ATOMIC_ACQUIRE);
+    for (size_t y = 0; y < height; y++) {
+        fill(dst + y * stride, value, width);
+    }
+}
+
+bool termui_cells_diff(const termui_cell_t *a, const termui_cell_t *b, size_t n,
+                       size_t *first, size_t *last) {
+    if (n == 0) {
+        return false;
+    }
+    return __atomic_load_n(&g_diff, __ATOMIC_ACQUIRE)(a, b, n, first, last);
+}
@@ -0,0 +1,209 @@
+/*
+ * termui - Frame Statistics
+ *
+ * Per-frame counters kept in a ring of the last TERMUI_STATS_WINDOW
+ * presented frames: render time, cells changed, bytes and write calls.
+ * Input events and missed loop deadlines are running totals. Percentiles
+ * are computed only when the stats are read.
+ *
+ * Disabled by default. While disabled, the hooks cost one relaxed load
+ * and a branch; render does not even read the clock.
+ */
+
+/* Enable clock_gettime */
+#define _POSIX_C_SOURCE 200809L
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    uint64_t render_ns;
+    uint32_t cells;
+    uint32_t bytes;
+    uint32_t writes;
+} frame_sample_t;
+
+static bool g_enabled = false;          /* Accessed atomically */
+
+/* Frame ring, under the output lock (render holds it) */
+static frame_sample_t g_ring[TERMUI_STATS_WINDOW];
+static int g_ring_next = 0;
+static int g_ring_count = 0;
+static uint64_t g_frames = 0;
+static uint64_t g_last_encoded = 0;     /* ANSI counters at the last frame */
+static uint64_t g_last_writes = 0;
+
+/* Updated atomically from the input and loop threads */
+static uint64_t g_input_events = 0;
+static uint64_t g_missed = 0;
+
+bool termui_stats_active(void) {
+    return __atomic_load_n(&g_enabled, __ATOMIC_RELAXED);
+}
+
+uint64_t termui_stats_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Current ANSI output counters (zero for ncurses) */
+static void output_counters(uint64_t *encoded, uint64_t *writes) {
+    bool ansi = termui_is_initialized() && termui_backend_encodes();
+    *encoded = ansi ? termui_ansi_bytes_encoded() : 0;
+    *writes = ansi ? termui_ansi_write_calls() : 0;
+}
+
+static void reset_locked(void) {
+    g_ring_next = 0;
+    g_ring_count = 0;
+    g_frames = 0;
+    output_counters(&g_last_encoded, &g_last_writes);
+    __atomic_store_n(&g_input_events, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_missed, 0, __ATOMIC_RELAXED);
+}
+
+void termui_stats_enable(bool enabled) {
+    termui_output_lock();
+    if (enabled && !termui_stats_active()) {
+        reset_locked();
+    }
+    __atomic_store_n(&g_enabled, enabled, __ATOMIC_RELAXED);
+    termui_output_unlock();
+}
+
+void termui_stats_reset(void) {
+    termui_output_lock();
+    reset_locked();
+    termui_output_unlock();
+}
+
+void termui_stats_record_frame(uint64_t render_ns, uint32_t cells) {
+    uint64_t encoded, writes;
+    output_counters(&encoded, &writes);
+
+    frame_sample_t *s = &g_ring[g_ring_next];
+    s->render_ns = render_ns;
+    s->cells = cells;
+    s->bytes = (uint32_t)(encoded - g_last_encoded);
+    s->writes = (uint32_t)(writes - g_last_writes);
+    g_last_encoded = encoded;
+    g_last_writes = writes;
+
+    g_ring_next = (g_ring_next + 1) % TERMUI_STATS_WINDOW;
+    if (g_ring_count < TERMUI_STATS_WINDOW) {
+        g_ring_count++;
+    }
+    g_frames++;
+}
+
+void termui_stats_note_input(int events) {
+    if (events > 0 && termui_stats_active()) {
+        __atomic_add_fetch(&g_input_events, (uint64_t)events, __ATOMIC_RELAXED);
+    }
+}
+
+void termui_stats_note_missed(uint64_t deadlines) {
+    if (deadlines > 0 && termui_stats_active()) {
+        __atomic_add_fetch(&g_missed, deadlines, __ATOMIC_RELAXED);
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Nearest-rank percentile of n sorted values */
+static uint64_t percentile(const uint64_t *sorted, int n, int pct) {
+    int rank = (pct * n + 99) / 100;
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+void termui_stats_get(termui_stats_t *stats) {
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(*stats));
+    uint64_t times[TERMUI_STATS_WINDOW];
+
+    termui_output_lock();
+    int n = g_ring_count;
+    stats->frames = g_frames;
+    stats->window = n;
+    if (n > 0) {
+        const frame_sample_t *last = &g_ring[(g_ring_next + TERMUI_STATS_WINDOW - 1) % TERMUI_STATS_WINDOW];
+        stats->render_ns = last->render_ns;
+        stats->cells_changed = last->cells;
+        stats->bytes = last->bytes;
+        stats->writes = last->writes;
+
+        uint64_t cells = 0, bytes = 0;
+        for (int i = 0; i < n; i++) {
+            times[i] = g_ring[i].render_ns;
+            cells += g_ring[i].cells;
+            bytes += g_ring[i].bytes;
+        }
+        stats->avg_cells_changed = (double)cells / n;
+        stats->avg_bytes = (double)bytes / n;
+    }
+    termui_output_unlock();
+
+    stats->input_events = __atomic_load_n(&g_input_events, __ATOMIC_RELAXED);
+    stats->missed_deadlines = __atomic_load_n(&g_missed, __ATOMIC_RELAXED);
+
+    if (n > 0) {
+        qsort(times, (size_t)n, sizeof(uint64_t), compare_u64);
+        stats->render_ns_p50 = percentile(times, n, 50);
+        stats->render_ns_p95 = percentile(times, n, 95);
+        stats->render_ns_p99 = percentile(times, n, 99);
+        stats->render_ns_max = times[n - 1];
+    }
+}
+
+#define HUD_WIDTH  30
+#define HUD_HEIGHT 6
+#define HUD_TEXT   (HUD_WIDTH - 2)  /* Characters inside the box */
+
+void termui_stats_draw_hud(termui_buffer_t *buf, termui_hud_corner_t corner) {
+    if (!buf || buf->width < HUD_WIDTH || buf->height < HUD_HEIGHT) return;
+
+    termui_stats_t st;
+    termui_stats_get(&st);
+
+    int x = corner == TERMUI_HUD_TOP_LEFT || corner == TERMUI_HUD_BOTTOM_LEFT ? 0 : buf->width - HUD_WIDTH;
+    int y = corner == TERMUI_HUD_TOP_LEFT || corner == TERMUI_HUD_TOP_RIGHT ? 0 : buf->height - HUD_HEIGHT;
+
+    /* Opaque background, then the figures */
+    char line[HUD_TEXT + 1];
+    memset(line, ' ', HUD_TEXT);
+    line[HUD_TEXT] = '\0';
+    for (int row = 1; row < HUD_HEIGHT - 1; row++) {
+        termui_buffer_draw_string(buf, x + 1, y + row, line, TERMUI_COLOR_DEFAULT);
+    }
+    termui_buffer_draw_box(buf, x, y, HUD_WIDTH, HUD_HEIGHT, TERMUI_COLOR_CYAN);
+    termui_buffer_draw_string(buf, x + 2, y, " termui ", TERMUI_COLOR_CYAN);
+
+    snprintf(line, sizeof(line), "frame %6.0f us  p50 %6.0f",
+             (double)st.render_ns / 1e3, (double)st.render_ns_p50 / 1e3);
+    termui_buffer_draw_string(buf, x + 1, y + 1, line, TERMUI_COLOR_WHITE);
+
+    snprintf(line, sizeof(line), "p95 %6.0f  p99 %6.0f us",
+             (double)st.render_ns_p95 / 1e3, (double)st.render_ns_p99 / 1e3);
+    termui_buffer_draw_string(buf, x + 1, y + 2, line, TERMUI_COLOR_WHITE);
+
+    snprintf(line, sizeof(line), "cells %6u  bytes %7u",
+             (unsigned int)st.cells_changed, (unsigned int)st.bytes);
+    termui_buffer_draw_string(buf, x + 1, y + 3, line, TERMUI_COLOR_WHITE);
+
+    snprintf(line, sizeof(line), "writes %u in %llu miss %llu",
+             (unsigned int)st.writes, (unsigned long long)st.input_events,
+             (unsigned long long)st.missed_deadlines);
+    termui_buffer_draw_string(buf, x + 1, y + 4, line,
+                              st.missed_deadlines ? TERMUI_COLOR_YELLOW : TERMUI_COLOR_WHITE);
+}
@@ -0,0 +1,306 @@
+/*
+ * termui - Cell Styles
+ *
+ * A style is a foreground, a background (each default, a 256-color
+ * palette index or 24-bit RGB) and attribute flags. Styles are interned
+ * into a global table like glyphs, so a cell keeps a 15-bit style id and
+ * stays one 32-bit word. Ids 0-7 are the basic termui_color_t colors, so
+ * cells drawn with the plain color API are unchanged.
+ *
+ * Colors are reduced to what the terminal supports when they are
+ * encoded: RGB to the nearest 256-color cube or gray entry, 256 colors
+ * to the nearest of the 16 ANSI colors.
+ *
+ * As with glyphs, interning takes a mutex and lookups by id are
+ * lock-free: styles live in pages that never move.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Interned styles in pages */
+#define STYLE_PAGE_SIZE 256
+#define STYLE_PAGES     (TERMUI_STYLE_LIMIT / STYLE_PAGE_SIZE)
+
+static termui_style_t *g_pages[STYLE_PAGES];
+static unsigned int g_count = 0;        /* Accessed atomically */
+static pthread_mutex_t g_intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Open-addressed hash of style ids + 1 (0: empty slot) */
+static uint16_t *g_slots = NULL;
+static size_t g_slot_count = 0;
+
+static termui_color_mode_t g_mode = TERMUI_COLORS_16;
+
+/* ANSI palette index of each termui_color_t */
+static const unsigned char g_basic_index[] = {
+    0, 7, 6, 4, 3, 1, 2, 5
+};
+
+/* termui_color_t of each ANSI palette index 0-7 (black shows as default) */
+static const termui_color_t g_basic_color[] = {
+    TERMUI_COLOR_DEFAULT, TERMUI_COLOR_RED, TERMUI_COLOR_GREEN, TERMUI_COLOR_YELLOW,
+    TERMUI_COLOR_BLUE, TERMUI_COLOR_MAGENTA, TERMUI_COLOR_CYAN, TERMUI_COLOR_WHITE
+};
+
+/* RGB of the 16 ANSI colors (xterm defaults) */
+static const unsigned char g_ansi_rgb[16][3] = {
+    {0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0},
+    {0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+    {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0},
+    {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}
+};
+
+/* Levels of the 6x6x6 color cube */
+static const unsigned char g_cube_level[6] = { 0, 95, 135, 175, 215, 255 };
+
+static size_t hash_style(const termui_style_t *s) {
+    uint64_t h = ((uint64_t)s->fg << 32 | s->bg) * 0x9e3779b97f4a7c15ull;
+    h ^= (h >> 29) ^ s->attrs;
+    h *= 0xff51afd7ed558ccdull;
+    return (size_t)(h >> 32);
+}
+
+static bool style_equal(const termui_style_t *a, const termui_style_t *b) {
+    return a->fg == b->fg && a->bg == b->bg && a->attrs == b->attrs;
+}
+
+static termui_style_t* entry(unsigned int id) {
+    return &g_pages[id / STYLE_PAGE_SIZE][id % STYLE_PAGE_SIZE];
+}
+
+static bool slots_grow(void) {
+    size_t count = g_slot_count ? g_slot_count * 2 : 64;
+    uint16_t *slots = calloc(count, sizeof(uint16_t));
+    if (!slots) {
+        return false;
+    }
+
+    for (unsigned int id = 0; id < g_count; id++) {
+        size_t i = hash_style(entry(id)) & (count - 1);
+        while (slots[i]) {
+            i = (i + 1) & (count - 1);
+        }
+        slots[i] = (uint16_t)(id + 1);
+    }
+
+    free(g_slots);
+    g_slots = slots;
+    g_slot_count = count;
+    return true;
+}
+
+/* Add a style without looking it up first; lock held */
+static bool style_add(const termui_style_t *s) {
+    if (g_count >= TERMUI_STYLE_LIMIT) {
+        return false;
+    }
+    unsigned int page = g_count / STYLE_PAGE_SIZE;
+    if (!g_pages[page]) {
+        g_pages[page] = malloc(STYLE_PAGE_SIZE * sizeof(termui_style_t));
+        if (!g_pages[page]) {
+            return false;
+        }
+    }
+    /* Keep the hash at most half full */
+    if ((g_count + 1) * 2 > g_slot_count && !slots_grow()) {
+        return false;
+    }
+
+    size_t i = hash_style(s) & (g_slot_count - 1);
+    while (g_slots[i]) {
+        i = (i + 1) & (g_slot_count - 1);
+    }
+    *entry(g_count) = *s;
+    g_slots[i] = (uint16_t)(g_count + 1);
+
+    /* Readers see the style complete before they see the count */
+    __atomic_store_n(&g_count, g_count + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Ids 0-7: the basic colors, foreground only; lock held */
+static bool styles_ready(void) {
+    if (g_count > 0) {
+        return true;
+    }
+
+    for (int c = TERMUI_COLOR_DEFAULT; c <= TERMUI_COLOR_MAGENTA; c++) {
+        termui_style_t s = {
+            c == TERMUI_COLOR_DEFAULT ? TERMUI_XCOLOR_DEFAULT : TERMUI_XCOLOR_INDEX(g_basic_index[c]),
+            TERMUI_XCOLOR_DEFAULT,
+            0
+        };
+        if (!style_add(&s)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Intern with the lock held */
+static unsigned int intern_locked(const termui_style_t *s) {
+    if (!styles_ready()) {
+        return TERMUI_COLOR_DEFAULT;
+    }
+
+    size_t i = hash_style(s) & (g_slot_count - 1);
+    while (g_slots[i]) {
+        unsigned int id = g_slots[i] - 1u;
+        if (style_equal(entry(id), s)) {
+            return id;
+        }
+        i = (i + 1) & (g_slot_count - 1);
+    }
+
+    /* Table full: keep the foreground as a basic color */
+    if (!style_add(s)) {
+        return termui_xcolor_basic(s->fg, NULL);
+    }
+    return g_count - 1;
+}
+
+unsigned int termui_style_intern(const termui_style_t *style) {
+    if (!style) {
+        return TERMUI_COLOR_DEFAULT;
+    }
+
+    termui_style_t s = *style;
+    s.attrs &= TERMUI_ATTR_BOLD | TERMUI_ATTR_UNDERLINE | TERMUI_ATTR_REVERSE;
+
+    pthread_mutex_lock(&g_intern_lock);
+    unsigned int id = intern_locked(&s);
+    pthread_mutex_unlock(&g_intern_lock);
+    return id;
+}
+
+const termui_style_t* termui_style_get(unsigned int id) {
+    static const termui_style_t plain = { TERMUI_XCOLOR_DEFAULT, TERMUI_XCOLOR_DEFAULT, 0 };
+    if (id >= __atomic_load_n(&g_count, __ATOMIC_ACQUIRE)) {
+        return &plain;
+    }
+    return entry(id);
+}
+
+void termui_style_init(termui_color_mode_t requested) {
+    pthread_mutex_lock(&g_intern_lock);
+    styles_ready();
+    pthread_mutex_unlock(&g_intern_lock);
+
+    if (requested != TERMUI_COLORS_AUTO) {
+        g_mode = requested;
+        return;
+    }
+
+    if (termui_active_backend() == TERMUI_BACKEND_HEADLESS) {
+        g_mode = TERMUI_COLORS_TRUECOLOR;
+        return;
+    }
+    if (termui_active_backend() == TERMUI_BACKEND_NCURSES) {
+        g_mode = TERMUI_COLORS_16;  /* Color pairs are basic colors only */
+        return;
+    }
+
+    const char *colorterm = getenv("COLORTERM");
+    const char *term = getenv("TERM");
+    if (colorterm && (strcmp(colorterm, "truecolor") == 0 || strcmp(colorterm, "24bit") == 0)) {
+        g_mode = TERMUI_COLORS_TRUECOLOR;
+    } else if (term && strstr(term, "256color")) {
+        g_mode = TERMUI_COLORS_256;
+    } else {
+        g_mode = TERMUI_COLORS_16;
+    }
+}
+
+termui_color_mode_t termui_get_color_mode(void) {
+    return g_mode;
+}
+
+static int distance(int r1, int g1, int b1, int r2, int g2, int b2) {
+    int dr = r1 - r2, dg = g1 - g2, db = b1 - b2;
+    return dr * dr * 3 + dg * dg * 4 + db * db * 2;
+}
+
+/* RGB of a palette index */
+static void index_rgb(unsigned int index, int *r, int *g, int *b) {
+    if (index < 16) {
+        *r = g_ansi_rgb[index][0];
+        *g = g_ansi_rgb[index][1];
+        *b = g_ansi_rgb[index][2];
+    } else if (index < 232) {
+        index -= 16;
+        *r = g_cube_level[index / 36];
+        *g = g_cube_level[(index / 6) % 6];
+        *b = g_cube_level[index % 6];
+    } else {
+        *r = *g = *b = 8 + (int)(index - 232) * 10;
+    }
+}
+
+static int cube_step(int v) {
+    return v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40;
+}
+
+static unsigned int rgb_to_256(int r, int g, int b) {
+    int cr = cube_step(r), cg = cube_step(g), cb = cube_step(b);
+    unsigned int cube = 16u + (unsigned int)(36 * cr + 6 * cg + cb);
+
+    int avg = (r + g + b) / 3;
+    int step = avg < 8 ? 0 : avg > 238 ? 23 : (avg - 3) / 10;
+    unsigned int gray = 232u + (unsigned int)step;
+    int level = 8 + step * 10;
+
+    int d_cube = distance(r, g, b, g_cube_level[cr], g_cube_level[cg], g_cube_level[cb]);
+    int d_gray = distance(r, g, b, level, level, level);
+    return d_gray < d_cube ? gray : cube;
+}
+
+static unsigned int rgb_to_16(int r, int g, int b) {
+    unsigned int best = 0;
+    int best_d = -1;
+    for (unsigned int i = 0; i < 16; i++) {
+        int d = distance(r, g, b, g_ansi_rgb[i][0], g_ansi_rgb[i][1], g_ansi_rgb[i][2]);
+        if (best_d < 0 || d < best_d) {
+            best = i;
+            best_d = d;
+        }
+    }
+    return best;
+}
+
+termui_xcolor_t termui_xcolor_reduce(termui_xcolor_t color, termui_color_mode_t mode) {
+    uint32_t kind = color & 0xff000000u;
+    if (kind == TERMUI_XCOLOR_DEFAULT || mode == TERMUI_COLORS_TRUECOLOR) {
+        return color;
+    }
+
+    int r, g, b;
+    if (kind == TERMUI_XCOLOR_INDEX(0)) {
+        unsigned int index = color & 0xffu;
+        if (index < 16 || mode == TERMUI_COLORS_256) {
+            return color;
+        }
+        index_rgb(index, &r, &g, &b);
+        return TERMUI_XCOLOR_INDEX(rgb_to_16(r, g, b));
+    }
+
+    r = (int)((color >> 16) & 0xffu);
+    g = (int)((color >> 8) & 0xffu);
+    b = (int)(color & 0xffu);
+    if (mode == TERMUI_COLORS_256) {
+        return TERMUI_XCOLOR_INDEX(rgb_to_256(r, g, b));
+    }
+    return TERMUI_XCOLOR_INDEX(rgb_to_16(r, g, b));
+}
+
+termui_color_t termui_xcolor_basic(termui_xcolor_t color, bool *bright) {
+    termui_xcolor_t c = termui_xcolor_reduce(color, TERMUI_COLORS_16);
+    if (bright) *bright = c != TERMUI_XCOLOR_DEFAULT && (c & 0xffu) >= 8;
+    if (c == TERMUI_XCOLOR_DEFAULT) {
+        return TERMUI_COLOR_DEFAULT;
+    }
+    return g_basic_color[(c & 0xffu) % 8];
+}
@@ -0,0 +1,219 @@
+/*
+ * termui - Render Thread
+ *
+ * Moves terminal output off the simulation thread. Frames are handed
+ * over through a triple buffer: the app copies a finished frame into
+ * the back slot and swaps it with the middle slot in one atomic
+ * exchange; the render thread swaps the middle slot with its front slot
+ * whenever it is marked fresh. A frame submitted while the previous one
+ * was still waiting replaces it (counted as dropped), so the terminal
+ * always gets the newest frame and a slow terminal never blocks submit.
+ *
+ * The render thread diffs each frame into its own screen buffer, so
+ * differential rendering and scroll detection work as usual.
+ */
+
+/* Enable pthreads */
+#define _POSIX_C_SOURCE 200809L
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Middle slot word: slot index plus a fresh bit */
+#define SLOT_MASK  0x3
+#define SLOT_FRESH 0x4
+
+/* Recheck interval while output is queued for a slow terminal */
+#define DRAIN_POLL_NS 2000000l
+
+struct termui_render_thread {
+    termui_buffer_t *slots[3];
+    int back;               /* Owned by the app thread */
+    int middle;             /* Shared, accessed atomically */
+    int front;              /* Owned by the render thread */
+    termui_buffer_t *screen; /* Presented by the render thread */
+
+    pthread_t thread;
+    pthread_mutex_t lock;   /* Only for sleeping while idle */
+    pthread_cond_t wake;
+    bool stopping;          /* Under lock */
+
+    termui_render_thread_stats_t stats; /* Fields updated atomically */
+};
+
+/* Make dst a copy of src, creating or resizing it as needed */
+static bool slot_copy(termui_buffer_t **dst, const termui_buffer_t *src) {
+    if (!*dst || (*dst)->width != src->width || (*dst)->height != src->height) {
+        termui_buffer_t *buf = termui_buffer_create(src->width, src->height);
+        if (!buf) {
+            return false;
+        }
+        termui_buffer_destroy(*dst);
+        *dst = buf;
+    }
+
+    memcpy((*dst)->cells, src->cells,
+           (size_t)src->width * (size_t)src->height * sizeof(termui_cell_t));
+    return true;
+}
+
+/* Bring the screen buffer up to date with a frame, marking only the
+ * changed span of each row dirty. False if a screen buffer of the
+ * frame's size could not be created */
+static bool screen_update(termui_render_thread_t *rt, const termui_buffer_t *frame) {
+    termui_buffer_t *screen = rt->screen;
+    if (!screen || screen->width != frame->width || screen->height != frame->height) {
+        /* New size: a fresh buffer repaints everything */
+        termui_buffer_t *buf = termui_buffer_create(frame->width, frame->height);
+        if (!buf) {
+            return false;
+        }
+        termui_buffer_destroy(rt->screen);
+        rt->screen = screen = buf;
+    }
+
+    for (int y = 0; y < frame->height; y++) {
+        size_t row = (size_t)y * (size_t)frame->width;
+        size_t first, last;
+        if (termui_cells_diff(frame->cells + row, screen->cells + row, (size_t)frame->width,
+                              &first, &last)) {
+            memcpy(screen->cells + row + first, frame->cells + row + first,
+                   (last - first + 1) * sizeof(termui_cell_t));
+            termui_buffer_mark_dirty(screen, y, (int)first, (int)last + 1);
+        }
+    }
+    return true;
+}
+
+static void* render_main(void *arg) {
+    termui_render_thread_t *rt = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&rt->lock);
+        while (!(__atomic_load_n(&rt->middle, __ATOMIC_ACQUIRE) & SLOT_FRESH) && !rt->stopping) {
+            /* A deferred frame goes out once the terminal catches up */
+            termui_output_service();
+            if (termui_output_pending() == 0) {
+                pthread_cond_wait(&rt->wake, &rt->lock);
+                continue;
+            }
+
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += DRAIN_POLL_NS;
+            if (until.tv_nsec >= 1000000000l) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000l;
+            }
+            pthread_cond_timedwait(&rt->wake, &rt->lock, &until);
+        }
+        bool stopping = rt->stopping;
+        pthread_mutex_unlock(&rt->lock);
+
+        /* Take the newest frame; the old front becomes the next spare */
+        if (__atomic_load_n(&rt->middle, __ATOMIC_ACQUIRE) & SLOT_FRESH) {
+            int old = __atomic_exchange_n(&rt->middle, rt->front, __ATOMIC_ACQ_REL);
+            rt->front = old & SLOT_MASK;
+
+            /* Under the output lock: termui_output_service may be
+             * presenting a deferred screen from another thread */
+            termui_output_lock();
+            bool updated = screen_update(rt, rt->slots[rt->front]);
+            if (updated) {
+                termui_buffer_render_locked(rt->screen);
+            }
+            termui_output_unlock();
+            if (updated) {
+                __atomic_add_fetch(&rt->stats.presented, 1, __ATOMIC_RELAXED);
+            }
+            continue;  /* Present whatever arrived meanwhile before stopping */
+        }
+
+        if (stopping) {
+            termui_output_flush(-1);  /* Including a deferred last frame */
+            break;
+        }
+    }
+    return NULL;
+}
+
+termui_render_thread_t* termui_render_thread_start(void) {
+    if (!termui_is_initialized()) {
+        return NULL;
+    }
+
+    termui_render_thread_t *rt = calloc(1, sizeof(termui_render_thread_t));
+    if (!rt) {
+        return NULL;
+    }
+
+    rt->back = 0;
+    rt->middle = 1;
+    rt->front = 2;
+    pthread_mutex_init(&rt->lock, NULL);
+    pthread_cond_init(&rt->wake, NULL);
+
+    if (pthread_create(&rt->thread, NULL, render_main, rt) != 0) {
+        pthread_cond_destroy(&rt->wake);
+        pthread_mutex_destroy(&rt->lock);
+        free(rt);
+        return NULL;
+    }
+    return rt;
+}
+
+void termui_render_thread_stop(termui_render_thread_t *rt) {
+    if (!rt) return;
+
+    pthread_mutex_lock(&rt->lock);
+    rt->stopping = true;
+    pthread_cond_signal(&rt->wake);
+    pthread_mutex_unlock(&rt->lock);
+    pthread_join(rt->thread, NULL);
+
+    for (int i = 0; i < 3; i++) {
+        termui_buffer_destroy(rt->slots[i]);
+    }
+    termui_buffer_destroy(rt->screen);
+    pthread_cond_destroy(&rt->wake);
+    pthread_mutex_destroy(&rt->lock);
+    free(rt);
+}
+
+int termui_render_thread_submit(termui_render_thread_t *rt, const termui_buffer_t *frame) {
+    if (!rt || !frame || frame->view) return TERMUI_INVALID;
+
+    if (!slot_copy(&rt->slots[rt->back], frame)) {
+        return TERMUI_NOMEM;
+    }
+
+    /* Publish; whatever was in the middle becomes the new back slot */
+    int old = __atomic_exchange_n(&rt->middle, rt->back | SLOT_FRESH, __ATOMIC_ACQ_REL);
+    rt->back = old & SLOT_MASK;
+    __atomic_add_fetch(&rt->stats.submitted, 1, __ATOMIC_RELAXED);
+    if (old & SLOT_FRESH) {
+        __atomic_add_fetch(&rt->stats.dropped, 1, __ATOMIC_RELAXED);
+        return TERMUI_OK;  /* Render thread is busy and will find this frame */
+    }
+
+    pthread_mutex_lock(&rt->lock);
+    pthread_cond_signal(&rt->wake);
+    pthread_mutex_unlock(&rt->lock);
+    return TERMUI_OK;
+}
+
+void termui_render_thread_get_stats(termui_render_thread_t *rt, termui_render_thread_stats_t *stats) {
+    if (!stats) return;
+
+    if (!rt) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    stats->submitted = __atomic_load_n(&rt->stats.submitted, __ATOMIC_RELAXED);
+    stats->presented = __atomic_load_n(&rt->stats.presented, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&rt->stats.dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,145 @@
+/*
+ * termui - Tiled Drawing
+ *
+ * Splits a buffer into a grid of tiles so several threads can draw into
+ * it at once. Each tile is a view buffer: the normal drawing functions
+ * work on it in tile-local coordinates, clipped to the tile, and record
+ * damage in the tile's own map. Nothing is shared between tiles, so
+ * drawing takes no locks.
+ *
+ * The buffer picks up the tiles' damage whenever it is rendered or its
+ * damage is queried, which must happen only after the drawing threads
+ * are done with the frame (joined, or past a barrier). Resizing the
+ * buffer re-splits it among the same tile handles; a grid finer than the
+ * new size leaves some tiles empty.
+ */
+
+#include "termui.h"
+#include "termui_internal.h"
+#include <stdlib.h>
+
+struct termui_tiles {
+    termui_buffer_t *buf;
+    int columns;
+    int rows;
+    termui_buffer_t **views;    /* columns * rows, row-major */
+    int *x;                     /* Tile origins in buf */
+    int *y;
+};
+
+/* Start of part i when n parts split size as evenly as possible */
+static int split(int size, int n, int i) {
+    return (int)((long)size * i / n);
+}
+
+termui_tiles_t* termui_tiles_create(termui_buffer_t *buf, int columns, int rows) {
+    if (!buf || buf->view || buf->front->tiles || columns <= 0 || rows <= 0) {
+        return NULL;
+    }
+    if (columns > buf->width) columns = buf->width;
+    if (rows > buf->height) rows = buf->height;
+
+    termui_tiles_t *tiles = calloc(1, sizeof(termui_tiles_t));
+    if (!tiles) {
+        return NULL;
+    }
+
+    int count = columns * rows;
+    tiles->buf = buf;
+    tiles->columns = columns;
+    tiles->rows = rows;
+    tiles->views = calloc((size_t)count, sizeof(termui_buffer_t *));
+    tiles->x = malloc((size_t)count * sizeof(int));
+    tiles->y = malloc((size_t)count * sizeof(int));
+    if (!tiles->views || !tiles->x || !tiles->y) {
+        termui_tiles_destroy(tiles);
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        tiles->views[i] = termui_buffer_view_create(buf, 0, 0, 0, 0);
+        if (!tiles->views[i]) {
+            termui_tiles_destroy(tiles);
+            return NULL;
+        }
+    }
+
+    buf->front->tiles = tiles;
+    if (!termui_tiles_layout(buf)) {
+        termui_tiles_destroy(tiles);
+        return NULL;
+    }
+    return tiles;
+}
+
+bool termui_tiles_layout(termui_buffer_t *buf) {
+    termui_tiles_t *tiles = buf->front->tiles;
+    bool ok = true;
+
+    for (int r = 0; r < tiles->rows; r++) {
+        int y0 = split(buf->height, tiles->rows, r);
+        int y1 = split(buf->height, tiles->rows, r + 1);
+        for (int c = 0; c < tiles->columns; c++) {
+            int x0 = split(buf->width, tiles->columns, c);
+            int x1 = split(buf->width, tiles->columns, c + 1);
+            int i = r * tiles->columns + c;
+
+            /* Out of memory: leave the tile empty rather than stale */
+            if (!termui_buffer_view_place(tiles->views[i], buf, x0, y0, x1 - x0, y1 - y0)) {
+                termui_buffer_view_place(tiles->views[i], buf, 0, 0, 0, 0);
+                ok = false;
+            }
+            tiles->x[i] = x0;
+            tiles->y[i] = y0;
+        }
+    }
+    return ok;
+}
+
+void termui_tiles_destroy(termui_tiles_t *tiles) {
+    if (!tiles) return;
+
+    if (tiles->buf->front->tiles == tiles) {
+        termui_tiles_collect(tiles->buf);  /* Keep what was drawn */
+        tiles->buf->front->tiles = NULL;
+    }
+    if (tiles->views) {
+        for (int i = 0; i < tiles->columns * tiles->rows; i++) {
+            termui_buffer_view_destroy(tiles->views[i]);
+        }
+    }
+    free(tiles->views);
+    free(tiles->x);
+    free(tiles->y);
+    free(tiles);
+}
+
+int termui_tiles_count(const termui_tiles_t *tiles) {
+    return tiles ? tiles->columns * tiles->rows : 0;
+}
+
+termui_buffer_t* termui_tiles_get(termui_tiles_t *tiles, int index) {
+    if (!tiles || index < 0 || index >= tiles->columns * tiles->rows) {
+        return NULL;
+    }
+    return tiles->views[index];
+}
+
+bool termui_tiles_get_rect(const termui_tiles_t *tiles, int index, int *x, int *y, int *width, int *height) {
+    if (!tiles || index < 0 || index >= tiles->columns * tiles->rows) {
+        return false;
+    }
+    if (x) *x = tiles->x[index];
+    if (y) *y = tiles->y[index];
+    termui_buffer_get_size(tiles->views[index], width, height);
+    return true;
+}
+
+void termui_tiles_collect(const termui_buffer_t *buf) {
+    termui_tiles_t *tiles = buf->front->tiles;
+    if (!tiles) return;
+
+    for (int i = 0; i < tiles->columns * tiles->rows; i++) {
+        termui_buffer_view_commit(tiles->views[i], tiles->buf, tiles->x[i], tiles->y[i]);
+    }
+}
@@ -0,0 +1,227 @@
+/*
+ * termui - Render Benchmark
+ *
+ * Runs standard render workloads on the headless backend at several
+ * screen sizes and prints one JSON object per line:
+ *
+ *   {"workload":"sparse","width":80,"height":24,"frames":300,
+ *    "ns_per_frame":...,"cells_per_sec":...,"bytes_per_frame":...,
+ *    "writes_per_frame":...}
+ *
+ * Only termui_buffer_render is timed; drawing the workload is not. The
+ * time includes the headless terminal model parsing the output, so it is
+ * comparable between releases rather than an absolute terminal cost.
+ *
+ * Usage: bench_termui [--frames N] [--workload NAME]
+ */
+
+/* Enable clock_gettime */
+#define _POSIX_C_SOURCE 200809L
+
+#include "termui.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef void (*workload_fn)(termui_buffer_t *buf, int width, int height, int frame);
+
+typedef struct {
+    const char *name;
+    workload_fn draw;
+} workload_t;
+
+static const int g_sizes[][2] = {
+    { 80, 24 }, { 120, 40 }, { 200, 60 }, { 400, 120 }
+};
+
+static const termui_color_t g_colors[] = {
+    TERMUI_COLOR_WHITE, TERMUI_COLOR_CYAN, TERMUI_COLOR_BLUE, TERMUI_COLOR_YELLOW,
+    TERMUI_COLOR_RED, TERMUI_COLOR_GREEN, TERMUI_COLOR_MAGENTA
+};
+
+/* Deterministic so runs are comparable */
+static unsigned int g_seed = 1;
+
+static unsigned int next_random(void) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Every cell changes every frame; no row matches a shifted old row, so
+ * scroll detection cannot help */
+static void draw_full(termui_buffer_t *buf, int width, int height, int frame) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            char c = (char)('a' + (x * 7 + y * 13 + frame * 5) % 26);
+            termui_buffer_draw_char(buf, x, y, c, TERMUI_COLOR_WHITE);
+        }
+    }
+}
+
+/* 1% of the cells change at random positions */
+static void draw_sparse(termui_buffer_t *buf, int width, int height, int frame) {
+    if (frame == 0) {
+        draw_full(buf, width, height, 0);
+    }
+
+    int count = width * height / 100;
+    for (int i = 0; i < count; i++) {
+        int x = (int)(next_random() % (unsigned int)width);
+        int y = (int)(next_random() % (unsigned int)height);
+        termui_buffer_draw_char(buf, x, y, (char)('A' + next_random() % 26), TERMUI_COLOR_GREEN);
+    }
+}
+
+/* A log view: one new line at the bottom, everything else moves up */
+static void draw_scroll(termui_buffer_t *buf, int width, int height, int frame) {
+    char line[512];
+    for (int y = 0; y < height; y++) {
+        int n = frame + y;
+        int len = snprintf(line, sizeof(line), "[%08d] worker-%d: processed batch %d in %d ms",
+                           n, n % 8, n * 7, (n * 13) % 250);
+        if (len > width) len = width;
+        memset(line + len, ' ', (size_t)(width - len));
+        line[width] = '\0';
+        termui_buffer_draw_string(buf, 0, y, line, g_colors[n % 7]);
+    }
+}
+
+/* A box moving across a static patterned background */
+static void draw_moving_box(termui_buffer_t *buf, int width, int height, int frame) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            termui_buffer_draw_char(buf, x, y, (x + y) % 4 ? '.' : ':', TERMUI_COLOR_BLUE);
+        }
+    }
+
+    int box_w = width / 4, box_h = height / 4;
+    int span_x = width - box_w, span_y = height - box_h;
+    int x = span_x > 0 ? frame % span_x : 0;
+    int y = span_y > 0 ? (frame / 2) % span_y : 0;
+    termui_buffer_draw_box(buf, x, y, box_w, box_h, TERMUI_COLOR_YELLOW);
+    termui_buffer_draw_string(buf, x + 2, y + 1, "moving", TERMUI_COLOR_WHITE);
+}
+
+/* Every cell changes color every frame (not a scroll, as above) */
+static void draw_colors(termui_buffer_t *buf, int width, int height, int frame) {
+    for (int y = 0; y < height; y++) {
+        int stride = y % 2 ? 2 : 1;
+        for (int x = 0; x < width; x++) {
+            termui_buffer_draw_char(buf, x, y, '#', g_colors[(x * stride + frame) % 7]);
+        }
+    }
+}
+
+/* Drifting stars plotted on a braille canvas over the whole screen */
+static void draw_canvas(termui_buffer_t *buf, int width, int height, int frame) {
+    static termui_canvas_t *canvas = NULL;
+    if (frame == 0) {
+        termui_canvas_destroy(canvas);
+        canvas = termui_canvas_create(width, height, TERMUI_CANVAS_BRAILLE);
+    }
+
+    int pw, ph;
+    termui_canvas_get_size(canvas, &pw, &ph);
+    termui_canvas_clear(canvas);
+    for (unsigned int i = 0; i < 256; i++) {
+        unsigned int h = i * 2654435761u;
+        int x = (int)((h % (unsigned int)pw + (unsigned int)frame * (1 + (h >> 8) % 3)) % (unsigned int)pw);
+        int y = (int)((h >> 16) % (unsigned int)ph);
+        termui_canvas_set(canvas, x, y, g_colors[i % 7]);
+    }
+    termui_canvas_draw(canvas, buf, 0, 0);
+}
+
+static const workload_t g_workloads[] = {
+    { "full_redraw", draw_full },
+    { "sparse", draw_sparse },
+    { "scroll_log", draw_scroll },
+    { "moving_box", draw_moving_box },
+    { "color_heavy", draw_colors },
+    { "canvas_plot", draw_canvas }
+};
+
+static int run(const workload_t *w, int width, int height, int frames) {
+    termui_config_t config = termui_default_config();
+    config.backend = TERMUI_BACKEND_HEADLESS;
+    config.headless_width = width;
+    config.headless_height = height;
+    if (termui_init(&config) != TERMUI_OK) {
+        fprintf(stderr, "bench: termui_init failed\n");
+        return 1;
+    }
+
+    termui_buffer_t *buf = termui_buffer_create(width, height);
+    if (!buf) {
+        termui_cleanup();
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+
+    /* First frame is a full paint; measure the steady state after it */
+    g_seed = 1;
+    w->draw(buf, width, height, 0);
+    termui_buffer_render(buf);
+
+    termui_output_stats_t before, after;
+    termui_output_get_stats(&before);
+    int64_t elapsed = 0;
+    for (int frame = 1; frame <= frames; frame++) {
+        w->draw(buf, width, height, frame);
+        int64_t start = now_ns();
+        termui_buffer_render(buf);
+        elapsed += now_ns() - start;
+    }
+    termui_output_get_stats(&after);
+
+    termui_buffer_destroy(buf);
+    termui_cleanup();
+
+    double ns_per_frame = (double)elapsed / frames;
+    printf("{\"workload\":\"%s\",\"width\":%d,\"height\":%d,\"frames\":%d,"
+           "\"ns_per_frame\":%.0f,\"cells_per_sec\":%.0f,\"bytes_per_frame\":%.1f,"
+           "\"writes_per_frame\":%.2f}\n",
+           w->name, width, height, frames, ns_per_frame,
+           elapsed > 0 ? (double)width * height * frames * 1e9 / (double)elapsed : 0.0,
+           (double)(after.bytes_written - before.bytes_written) / frames,
+           (double)(after.write_calls - before.write_calls) / frames);
+    fflush(stdout);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int frames = 300;
+    const char *only = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--workload NAME]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames <= 0) {
+        frames = 1;
+    }
+
+    for (size_t w = 0; w < sizeof(g_workloads) / sizeof(g_workloads[0]); w++) {
+        if (only && strcmp(only, g_workloads[w].name) != 0) continue;
+
+        for (size_t s = 0; s < sizeof(g_sizes) / sizeof(g_sizes[0]); s++) {
+            if (run(&g_workloads[w], g_sizes[s][0], g_sizes[s][1], frames) != 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -2,22 +2,832 @@
  * termui - Simple Test Program
  *
  * Tests basic functionality of the termui library.
+ *
+ * Interactive by default. With --headless it needs no terminal: input is
+ * scripted, and the presented screen is read back and checked, exiting
+ * non-zero on a mismatch (make check).
  */
 
 #include "termui.h"
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/input.h>
+#include <pthread.h>
 #include <unistd.h>
+#endif
+
+static int g_failures = 0;
+
+/* Monotonic clock in milliseconds, for timing waits */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Timer callback: count the calls */
+static void count_tick(void *user) {
+    (*(int *)user)++;
+}
+
+/* A buffer redrawn with new content every frame */
+typedef struct {
+    termui_buffer_t *buf;
+    int frame;
+} churn_t;
+
+/* Draw callback: fill a row with a different letter each frame */
+static void draw_churn(void *user, double alpha) {
+    churn_t *churn = user;
+    (void)alpha;
+    churn->frame++;
+    termui_buffer_fill_rect(churn->buf, 2, 20, 60, 1, 'a' + churn->frame % 26, TERMUI_COLOR_WHITE);
+}
+
+/* Compare the start of a headless screen row with the expected text */
+static void expect_row(int y, int x, const char *text) {
+    char row[512];
+    termui_headless_get_row(y, row, sizeof(row));
+    if ((size_t)x > strlen(row) || strncmp(row + x, text, strlen(text)) != 0) {
+        fprintf(stderr, "FAIL: row %d col %d: expected \"%s\", got \"%s\"\n", y, x, text, row);
+        g_failures++;
+    }
+}
+
+/* Read back the presented screen and check what the test drew */
+static void check_headless(termui_buffer_t *buf) {
+    termui_buffer_render(buf);
+
+    expect_row(1, 25, "termui Test - Press Q to quit");
+    expect_row(4, 2, "WHITE   CYAN");
+    expect_row(9, 25, "RIGHT");
+    expect_row(15, 11, "caf\xc3\xa9 \xe6\xbc\xa2\xe5\xad\x97");
+
+    termui_color_t color;
+    uint32_t cp;
+    if (!termui_headless_get_cell(33, 4, &cp, &color) || cp != 'R' || color != TERMUI_COLOR_RED) {
+        fprintf(stderr, "FAIL: cell (33,4) is not a red 'R'\n");
+        g_failures++;
+    }
+    if (!termui_headless_get_cell(17, 15, &cp, NULL) || cp != 0) {
+        fprintf(stderr, "FAIL: cell (17,15) is not the right half of a wide glyph\n");
+        g_failures++;
+    }
+
+    /* One changed cell costs one cursor move, not a repaint */
+    termui_headless_stats_t stats;
+    termui_headless_reset_stats();
+    termui_buffer_draw_char(buf, 25, 9, 'L', TERMUI_COLOR_GREEN);
+    termui_buffer_render(buf);
+    termui_headless_get_stats(&stats);
+    expect_row(9, 25, "LIGHT");
+    if (stats.frames != 1 || stats.cursor_moves != 1 || stats.glyphs != 1 || stats.bytes > 32) {
+        fprintf(stderr, "FAIL: single-cell update sent %llu bytes, %llu moves, %llu glyphs\n",
+                (unsigned long long)stats.bytes, (unsigned long long)stats.cursor_moves,
+                (unsigned long long)stats.glyphs);
+        g_failures++;
+    }
+
+    /* Nearby changes are reached by re-sending the cell between, not a move */
+    termui_headless_reset_stats();
+    termui_buffer_draw_char(buf, 4, 11, 'i', TERMUI_COLOR_GREEN);
+    termui_buffer_draw_char(buf, 6, 11, 'N', TERMUI_COLOR_GREEN);
+    termui_buffer_render(buf);
+    termui_headless_get_stats(&stats);
+    expect_row(11, 4, "inNer content");
+    if (stats.cursor_moves != 1 || stats.glyphs != 3) {
+        fprintf(stderr, "FAIL: two nearby cells took %llu moves, %llu glyphs\n",
+                (unsigned long long)stats.cursor_moves, (unsigned long long)stats.glyphs);
+        g_failures++;
+    }
+
+    /* Extended styles arrive intact (headless is truecolor) */
+    termui_style_t sent = { TERMUI_XCOLOR_RGB(255, 128, 0), TERMUI_XCOLOR_INDEX(236), TERMUI_ATTR_BOLD };
+    termui_style_t got;
+    termui_buffer_draw_styled(buf, 25, 9, "L", &sent);
+    termui_buffer_render(buf);
+    if (!termui_headless_get_style(25, 9, &got) || got.fg != sent.fg || got.bg != sent.bg ||
+        got.attrs != sent.attrs) {
+        fprintf(stderr, "FAIL: cell (25,9) style %08x/%08x/%x\n", got.fg, got.bg, got.attrs);
+        g_failures++;
+    }
+
+    /* Tiles draw in local coordinates, clipped to their rectangle */
+    termui_tiles_t *tiles = termui_tiles_create(buf, 2, 1);
+    int tx;
+    termui_tiles_get_rect(tiles, 1, &tx, NULL, NULL, NULL);
+    termui_buffer_draw_string(termui_tiles_get(tiles, 1), 0, 19, "=", TERMUI_COLOR_WHITE);
+    termui_buffer_draw_string(termui_tiles_get(tiles, 0), tx - 1, 19, "<>", TERMUI_COLOR_WHITE);
+    termui_buffer_render(buf);
+    termui_tiles_destroy(tiles);
+    expect_row(19, tx - 1, "<=");
+
+    /* Display list groups redraw only when their key changes */
+    termui_display_list_t *list = termui_display_list_create(buf);
+    termui_group_t *group = termui_display_list_group(list, "score", 50, 17, 8, 1);
+    if (termui_group_begin(group, 1)) {
+        termui_group_draw_string(group, 0, 0, "score 1", TERMUI_COLOR_YELLOW);
+    }
+    int first = termui_display_list_replay(list);
+    bool again = termui_group_begin(group, 1);
+    int second = termui_display_list_replay(list);
+    termui_buffer_render(buf);
+    expect_row(17, 50, "score 1");
+    if (first != 1 || again || second != 0) {
+        fprintf(stderr, "FAIL: display list replayed %d then %d groups\n", first, second);
+        g_failures++;
+    }
+    termui_display_list_destroy(list);
+
+    /* Rectangle fill, length-bounded text, and blits within one buffer */
+    termui_buffer_fill_rect(buf, 50, 18, 6, 2, '.', TERMUI_COLOR_BLUE);
+    termui_buffer_draw_text_n(buf, 51, 18, "abcdef", 3, TERMUI_COLOR_WHITE);
+    termui_buffer_blit(buf, 60, 18, buf, 50, 18, 6, 2);
+    termui_buffer_blit(buf, 52, 18, buf, 50, 18, 6, 1);
+    termui_buffer_render(buf);
+    expect_row(18, 50, ".a.abc..  .abc..");
+    expect_row(19, 50, "......    ......");
+
+    /* Canvas pixels become braille and quadrant glyphs */
+    termui_canvas_t *dots = termui_canvas_create(2, 1, TERMUI_CANVAS_BRAILLE);
+    termui_canvas_t *quads = termui_canvas_create(2, 1, TERMUI_CANVAS_QUADRANT);
+    termui_canvas_set(dots, 0, 0, TERMUI_COLOR_GREEN);
+    termui_canvas_set(dots, 1, 3, TERMUI_COLOR_GREEN);
+    termui_canvas_set(quads, 2, 0, TERMUI_COLOR_RED);
+    termui_canvas_set(quads, 3, 1, TERMUI_COLOR_RED);
+    termui_canvas_draw(dots, buf, 50, 20);
+    termui_canvas_draw(quads, buf, 53, 20);
+    termui_buffer_render(buf);
+    uint32_t dot, quad;
+    termui_headless_get_cell(50, 20, &dot, NULL);
+    termui_headless_get_cell(54, 20, &quad, &color);
+    if (dot != 0x2881 || quad != 0x259a || color != TERMUI_COLOR_RED) {
+        fprintf(stderr, "FAIL: canvas cells U+%04X U+%04X\n", (unsigned int)dot, (unsigned int)quad);
+        g_failures++;
+    }
+
+    /* Unchanged canvases write nothing */
+    termui_canvas_draw(dots, buf, 50, 20);
+    if (termui_buffer_is_dirty(buf)) {
+        fprintf(stderr, "FAIL: redrawing an unchanged canvas damaged the buffer\n");
+        g_failures++;
+    }
+    termui_canvas_destroy(dots);
+    termui_canvas_destroy(quads);
+
+    /* Shapes rasterize on cells and clip to the canvas */
+    termui_point_t triangle[3] = { { 68, 21 }, { 72, 21 }, { 68, 22 } };
+    termui_buffer_draw_line(buf, 60, 21, 66, 22, '*', TERMUI_COLOR_GREEN);
+    termui_buffer_fill_polygon(buf, triangle, 3, '#', TERMUI_COLOR_MAGENTA);
+    dots = termui_canvas_create(2, 1, TERMUI_CANVAS_BRAILLE);
+    termui_canvas_draw_line(dots, -100, -100, 100, 100, TERMUI_COLOR_GREEN);
+    termui_canvas_draw(dots, buf, 75, 21);
+    termui_canvas_destroy(dots);
+    termui_buffer_render(buf);
+    expect_row(21, 60, "***     #####");
+    expect_row(22, 60, "   **** ###");
+    termui_headless_get_cell(75, 21, &dot, NULL);
+    termui_headless_get_cell(76, 21, &quad, NULL);
+    if (dot != 0x2811 || quad != 0x2884) {
+        fprintf(stderr, "FAIL: clipped canvas line U+%04X U+%04X\n", (unsigned int)dot, (unsigned int)quad);
+        g_failures++;
+    }
+
+    /* An unchanged frame sends nothing */
+    termui_headless_reset_stats();
+    termui_buffer_render(buf);
+    termui_headless_get_stats(&stats);
+    if (stats.bytes != 0) {
+        fprintf(stderr, "FAIL: unchanged frame sent %llu bytes\n", (unsigned long long)stats.bytes);
+        g_failures++;
+    }
+
+    /* A frame the terminal has not read at all is replaced by the next
+     * one; a partly written frame completes and the next one waits */
+    termui_output_stats_t before, after;
+    termui_output_get_stats(&before);
+    termui_headless_limit_output(0);
+    termui_buffer_draw_char(buf, 75, 22, 'a', TERMUI_COLOR_WHITE);
+    termui_buffer_render(buf);
+    termui_buffer_draw_char(buf, 75, 22, ' ', TERMUI_COLOR_WHITE);
+    termui_buffer_draw_char(buf, 76, 22, 'b', TERMUI_COLOR_WHITE);
+    termui_buffer_render(buf);
+    termui_headless_reset_stats();
+    termui_headless_limit_output(-1);
+    termui_output_flush(100);
+    termui_headless_get_stats(&stats);
+    expect_row(22, 75, " b");
+    termui_output_get_stats(&after);
+    if (after.frames_replaced != before.frames_replaced + 1 || stats.frames != 1) {
+        fprintf(stderr, "FAIL: unsent frame was not replaced (%llu frames reached the screen)\n",
+                (unsigned long long)stats.frames);
+        g_failures++;
+    }
+
+    termui_headless_limit_output(3);
+    termui_buffer_draw_char(buf, 77, 22, 'c', TERMUI_COLOR_WHITE);
+    termui_buffer_render(buf);
+    termui_buffer_draw_char(buf, 78, 22, 'd', TERMUI_COLOR_WHITE);
+    termui_buffer_render(buf);
+    termui_output_get_stats(&before);
+    termui_headless_reset_stats();
+    termui_headless_limit_output(-1);
+    termui_output_flush(100);
+    termui_headless_get_stats(&stats);
+    termui_output_get_stats(&after);
+    expect_row(22, 75, " bcd");
+    if (before.pending_bytes == 0 || after.frames_deferred == 0 || after.pending_bytes != 0 ||
+        stats.frames != 2) {
+        fprintf(stderr, "FAIL: partly written frame: %llu deferred, %llu frames reached the screen\n",
+                (unsigned long long)after.frames_deferred, (unsigned long long)stats.frames);
+        g_failures++;
+    }
+
+    /* A resize keeps the frame: growing sends the uncovered cells only,
+     * narrowing sends nothing */
+    int width, height;
+    termui_buffer_get_size(buf, &width, &height);
+    termui_headless_resize(width + 4, height);
+    termui_headless_reset_stats();
+    if (!termui_check_resize() || termui_buffer_resize(buf, width + 4, height) != TERMUI_OK) {
+        fprintf(stderr, "FAIL: resize to %dx%d not handled\n", width + 4, height);
+        g_failures++;
+    }
+    termui_buffer_render(buf);
+    termui_headless_get_stats(&stats);
+    expect_row(1, 25, "termui Test - Press Q to quit");
+    if (stats.glyphs > (uint64_t)(4 * height)) {
+        fprintf(stderr, "FAIL: growing by 4 columns sent %llu glyphs\n", (unsigned long long)stats.glyphs);
+        g_failures++;
+    }
+
+    termui_headless_resize(width - 10, height);
+    termui_check_resize();
+    termui_buffer_resize(buf, width - 10, height);
+    termui_headless_reset_stats();
+    termui_buffer_render(buf);
+    termui_headless_get_stats(&stats);
+    expect_row(4, 2, "WHITE   CYAN");
+    if (stats.bytes != 0) {
+        fprintf(stderr, "FAIL: narrowing sent %llu bytes\n", (unsigned long long)stats.bytes);
+        g_failures++;
+    }
+
+    /* Shrinking past the cursor scrolls the terminal: repainted in full */
+    termui_buffer_draw_char(buf, 1, height - 1, '*', TERMUI_COLOR_WHITE);
+    termui_buffer_render(buf);
+    termui_headless_resize(width - 10, height - 2);
+    termui_check_resize();
+    termui_buffer_resize(buf, width - 10, height - 2);
+    termui_buffer_render(buf);
+    expect_row(4, 2, "WHITE   CYAN");
+}
+
+/* A blank buffer covering the headless screen, for checks that present
+ * frames of their own */
+static termui_buffer_t* scratch_screen(void) {
+    int width, height;
+    termui_get_size(&width, &height);
+    return termui_buffer_create(width, height);
+}
+
+/* An unchanged frame sends nothing; one changed cell sends one run */
+static void check_damage(void) {
+    termui_buffer_t *scene = scratch_screen();
+    termui_buffer_draw_string(scene, 2, 8, "damage tracked", TERMUI_COLOR_CYAN);
+    termui_buffer_render(scene);
+
+    termui_headless_stats_t same, one;
+    termui_headless_reset_stats();
+    termui_buffer_render(scene);
+    termui_headless_get_stats(&same);
+
+    termui_headless_reset_stats();
+    termui_buffer_draw_char(scene, 2, 8, 'D', TERMUI_COLOR_CYAN);
+    termui_buffer_render(scene);
+    termui_headless_get_stats(&one);
+
+    expect_row(8, 2, "Damage tracked");
+    if (same.bytes != 0 || one.frames != 1 || one.glyphs != 1 || one.cursor_moves != 1 ||
+        one.bytes > 32) {
+        fprintf(stderr, "FAIL: unchanged frame sent %llu bytes; one cell sent %llu bytes, %llu glyphs\n",
+                (unsigned long long)same.bytes, (unsigned long long)one.bytes,
+                (unsigned long long)one.glyphs);
+        g_failures++;
+    }
+    termui_buffer_destroy(scene);
+}
+
+/* Packed-cell fills cover spans that are not a whole number of
+ * vectors, at any offset. make check runs this under TERMUI_SIMD=scalar,
+ * sse2 and avx2 */
+static void check_fill(void) {
+    termui_buffer_t *cells = termui_buffer_create(37, 3);
+    termui_buffer_fill_rect(cells, 0, 0, 37, 3, 'x', TERMUI_COLOR_WHITE);
+    termui_buffer_fill_rect(cells, 3, 0, 31, 1, 'o', TERMUI_COLOR_WHITE);
+    termui_buffer_draw_hline(cells, 1, 1, 35, '-', TERMUI_COLOR_WHITE);
+    termui_buffer_fill_rect(cells, 0, 2, 37, 1, '=', TERMUI_COLOR_WHITE);
+    termui_buffer_render(cells);
+
+    expect_row(0, 0, "xxxoooooooooooooooooooooooooooooooxxx");
+    expect_row(1, 0, "x-----------------------------------x");
+    expect_row(2, 0, "=====================================");
+    termui_buffer_destroy(cells);
+}
+
+/* The diff kernel reports the first and last changed column of spans
+ * that are not a whole number of vectors, with changes on the first and
+ * last lane */
+static void check_diff(void) {
+    termui_buffer_t *cells = termui_buffer_create(37, 4);
+    termui_buffer_fill_rect(cells, 0, 0, 37, 4, 'x', TERMUI_COLOR_WHITE);
+    termui_buffer_render(cells);
+
+    int first[4], last[4];
+    int clean = termui_buffer_diff_rows(cells, first, last);
+
+    /* Rewrite each row unchanged so the whole row is diffed, then
+     * change single cells at the edges of 4- and 8-cell vectors */
+    termui_buffer_fill_rect(cells, 0, 0, 37, 4, 'x', TERMUI_COLOR_WHITE);
+    termui_buffer_draw_char(cells, 0, 0, 'A', TERMUI_COLOR_WHITE);
+    termui_buffer_draw_char(cells, 36, 1, 'B', TERMUI_COLOR_WHITE);
+    termui_buffer_draw_char(cells, 8, 2, 'C', TERMUI_COLOR_WHITE);
+    termui_buffer_draw_char(cells, 31, 2, 'D', TERMUI_COLOR_WHITE);
+    termui_buffer_fill_rect(cells, 3, 3, 31, 1, 'o', TERMUI_COLOR_WHITE);
+
+    int changed = termui_buffer_diff_rows(cells, first, last);
+    static const int want_first[4] = { 0, 36, 8, 3 };
+    static const int want_last[4] = { 0, 36, 31, 33 };
+    for (int y = 0; y < 4; y++) {
+        if (first[y] != want_first[y] || last[y] != want_last[y]) {
+            fprintf(stderr, "FAIL: row %d changed in columns %d-%d, expected %d-%d (simd level %d)\n",
+                    y, first[y], last[y], want_first[y], want_last[y], (int)termui_simd_level());
+            g_failures++;
+        }
+    }
+
+    bool edges = termui_buffer_region_changed(cells, 0, 0, 1, 1) &&
+                 termui_buffer_region_changed(cells, 36, 1, 1, 1) &&
+                 termui_buffer_region_changed(cells, 31, 2, 6, 1);
+    bool between = termui_buffer_region_changed(cells, 1, 0, 36, 1) ||
+                   termui_buffer_region_changed(cells, 0, 1, 36, 1) ||
+                   termui_buffer_region_changed(cells, 9, 2, 22, 1);
+    if (clean != 0 || changed != 4 || !edges || between) {
+        fprintf(stderr, "FAIL: %d then %d rows changed, edge regions %d, unchanged regions %d\n",
+                clean, changed, (int)edges, (int)between);
+        g_failures++;
+    }
+    termui_buffer_destroy(cells);
+}
+
+/* A moved layer recomposites where it was and where it is now */
+static void check_compositor(void) {
+    termui_buffer_t *scene = scratch_screen();
+    termui_compositor_t *comp = termui_compositor_create(scene);
+    termui_layer_t *layer = termui_compositor_add_layer(comp, 10, 5, 4, 1, 0);
+    termui_buffer_draw_string(termui_layer_buffer(layer), 0, 0, "MOVE", TERMUI_COLOR_WHITE);
+    termui_compositor_compose(comp);
+    termui_buffer_render(scene);
+
+    termui_headless_stats_t stats;
+    termui_layer_set_offset(layer, 10, 6);
+    int composed = termui_compositor_compose(comp);
+    termui_headless_reset_stats();
+    termui_buffer_render(scene);
+    termui_headless_get_stats(&stats);
+    expect_row(5, 9, "      ");
+    expect_row(6, 10, "MOVE");
+    if (composed > 12 || stats.glyphs > 12) {
+        fprintf(stderr, "FAIL: moving a layer recomposited %d cells, sent %llu glyphs\n",
+                composed, (unsigned long long)stats.glyphs);
+        g_failures++;
+    }
+
+    termui_compositor_destroy(comp);
+    termui_buffer_destroy(scene);
+}
+
+/* Rows moved up by one scroll the terminal; only the new row is sent */
+static void check_scroll(void) {
+    termui_buffer_t *scene = scratch_screen();
+    char line[16];
+    for (int y = 2; y < 14; y++) {
+        snprintf(line, sizeof(line), "row %02d", y);
+        termui_buffer_draw_string(scene, 2, y, line, TERMUI_COLOR_WHITE);
+    }
+    termui_buffer_render(scene);
+
+    termui_headless_stats_t stats;
+    for (int y = 2; y < 14; y++) {
+        snprintf(line, sizeof(line), "row %02d", y + 1);
+        termui_buffer_draw_string(scene, 2, y, line, TERMUI_COLOR_WHITE);
+    }
+    termui_headless_reset_stats();
+    termui_buffer_render(scene);
+    termui_headless_get_stats(&stats);
+    expect_row(1, 2, "      ");
+    expect_row(2, 2, "row 03");
+    expect_row(13, 2, "row 14");
+    expect_row(14, 2, "      ");
+    if (stats.glyphs > 8 || stats.sequences < 3) {
+        fprintf(stderr, "FAIL: scrolled rows sent %llu glyphs in %llu sequences\n",
+                (unsigned long long)stats.glyphs, (unsigned long long)stats.sequences);
+        g_failures++;
+    }
+
+    termui_buffer_destroy(scene);
+}
+
+/* A buffer narrower than the terminal never scrolls it: the columns
+ * to its right belong to someone else */
+static void check_scroll_narrow(void) {
+    int width, height;
+    termui_get_size(&width, &height);
+    termui_buffer_t *edge = termui_buffer_create(width, height);
+    char line[16];
+    for (int y = 2; y < 14; y++) {
+        snprintf(line, sizeof(line), "E%02d", y);
+        termui_buffer_draw_string(edge, width - 6, y, line, TERMUI_COLOR_WHITE);
+    }
+    termui_buffer_render(edge);
+    termui_buffer_destroy(edge);
+
+    termui_buffer_t *scene = termui_buffer_create(width - 10, height);
+    for (int y = 2; y < 14; y++) {
+        snprintf(line, sizeof(line), "row %02d", y);
+        termui_buffer_draw_string(scene, 2, y, line, TERMUI_COLOR_WHITE);
+    }
+    termui_buffer_render(scene);
+    for (int y = 2; y < 14; y++) {
+        snprintf(line, sizeof(line), "row %02d", y + 1);
+        termui_buffer_draw_string(scene, 2, y, line, TERMUI_COLOR_WHITE);
+    }
+    termui_buffer_render(scene);
+
+    expect_row(2, 2, "row 03");
+    expect_row(13, 2, "row 14");
+    for (int y = 2; y < 14; y++) {
+        snprintf(line, sizeof(line), "E%02d", y);
+        expect_row(y, width - 6, line);
+    }
+    termui_buffer_destroy(scene);
+}
+
+/* A frame the terminal took none of is replaced by the next one, which
+ * is diffed against what was actually sent */
+static void check_replace(void) {
+    termui_buffer_t *scene = scratch_screen();
+    termui_buffer_render(scene);
+
+    termui_output_stats_t before, after;
+    termui_headless_stats_t stats;
+    termui_output_get_stats(&before);
+    termui_headless_limit_output(0);
+    termui_buffer_draw_string(scene, 2, 16, "AAAAAAAA", TERMUI_COLOR_WHITE);
+    termui_buffer_render(scene);
+    termui_buffer_draw_string(scene, 2, 16, "BBBB    ", TERMUI_COLOR_WHITE);
+    termui_buffer_render(scene);
+    termui_headless_reset_stats();
+    termui_headless_limit_output(-1);
+    termui_output_flush(100);
+    termui_headless_get_stats(&stats);
+    termui_output_get_stats(&after);
+
+    expect_row(16, 2, "BBBB    ");
+    if (after.frames_replaced - before.frames_replaced != 1 || stats.frames != 1 ||
+        after.pending_bytes != 0) {
+        fprintf(stderr, "FAIL: starved output replaced %llu frames, %llu reached the screen\n",
+                (unsigned long long)(after.frames_replaced - before.frames_replaced),
+                (unsigned long long)stats.frames);
+        g_failures++;
+    }
+    termui_buffer_destroy(scene);
+}
+
+/* Waits end on their timeout, a timer, or a wake, whichever is first */
+static void check_input_wait(void) {
+    int ticks = 0;
+    termui_input_wait(0);  /* Take the wake left by the scripted input */
+    double start = now_ms();
+    termui_input_t waited = termui_input_wait(20);
+    double idle = now_ms() - start;
+
+    termui_timer_add(5, false, count_tick, &ticks);
+    start = now_ms();
+    termui_input_wait(1000);
+    double timed = now_ms() - start;
 
-int main(void) {
+    termui_input_wake();
+    start = now_ms();
+    termui_input_wait(1000);
+    double woken = now_ms() - start;
+
+    if (waited != TERMUI_INPUT_NONE || idle < 19.0 || ticks != 1 || timed > 500.0 || woken > 500.0) {
+        fprintf(stderr, "FAIL: waits took %.1f ms idle, %.1f ms to a timer (%d ticks), %.1f ms to a wake\n",
+                idle, timed, ticks, woken);
+        g_failures++;
+    }
+}
+
+/* The render thread always ends on the newest submitted frame */
+static void check_render_thread(void) {
+    termui_buffer_t *scene = scratch_screen();
+    termui_render_thread_t *rt = termui_render_thread_start();
+    termui_render_thread_stats_t stats;
+    char line[16];
+    for (int i = 1; i <= 20; i++) {
+        snprintf(line, sizeof(line), "frame %02d", i);
+        termui_buffer_draw_string(scene, 2, 3, line, TERMUI_COLOR_WHITE);
+        termui_render_thread_submit(rt, scene);
+    }
+
+    double start = now_ms();
+    do {
+        struct timespec pause = { 0, 1000000 };
+        nanosleep(&pause, NULL);
+        termui_render_thread_get_stats(rt, &stats);
+    } while (stats.presented + stats.dropped < stats.submitted && now_ms() - start < 1000.0);
+    termui_render_thread_stop(rt);
+
+    expect_row(3, 2, "frame 20");
+    if (stats.submitted != 20 || stats.presented == 0 || stats.presented + stats.dropped != stats.submitted) {
+        fprintf(stderr, "FAIL: render thread presented %llu and dropped %llu of %llu frames\n",
+                (unsigned long long)stats.presented, (unsigned long long)stats.dropped,
+                (unsigned long long)stats.submitted);
+        g_failures++;
+    }
+    termui_buffer_destroy(scene);
+}
+
+/* Output the terminal does not read slows the render rate */
+static void check_pacing(void) {
+    termui_loop_config_t config = termui_loop_default_config();
+    config.update_hz = 200;
+    config.render_hz = 200;
+    config.min_render_hz = 10;
+    churn_t churn = { scratch_screen(), 0 };
+    termui_loop_t *loop = termui_loop_create(&config, churn.buf);
+    termui_loop_stats_t stats;
+
+    termui_headless_limit_output(0);
+    for (int i = 0; i < 40; i++) {
+        termui_loop_step(loop, NULL, draw_churn, &churn);
+    }
+    termui_loop_get_stats(loop, &stats);
+    termui_headless_limit_output(-1);
+    termui_output_flush(100);
+
+    if (stats.render_hz >= 100.0) {
+        fprintf(stderr, "FAIL: congested output left the render rate at %.1f Hz\n", stats.render_hz);
+        g_failures++;
+    }
+    termui_loop_destroy(loop);
+    termui_buffer_destroy(churn.buf);
+}
+
+/* Frame statistics count what the last render sent; the HUD shows them */
+static void check_stats_hud(void) {
+    termui_buffer_t *scene = scratch_screen();
+    termui_buffer_render(scene);
+
+    termui_headless_stats_t sent;
+    termui_stats_t stats;
+    termui_stats_enable(true);
+    termui_buffer_draw_string(scene, 40, 8, "stats", TERMUI_COLOR_WHITE);
+    termui_headless_reset_stats();
+    termui_buffer_render(scene);
+    termui_headless_get_stats(&sent);
+    termui_stats_get(&stats);
+    termui_stats_draw_hud(scene, TERMUI_HUD_TOP_LEFT);
+    termui_buffer_render(scene);
+    termui_stats_enable(false);
+
+    if (stats.frames != 1 || stats.cells_changed != 5 || stats.bytes != sent.bytes) {
+        fprintf(stderr, "FAIL: stats counted %llu frames, %u cells, %u of %llu bytes\n",
+                (unsigned long long)stats.frames, (unsigned int)stats.cells_changed,
+                (unsigned int)stats.bytes, (unsigned long long)sent.bytes);
+        g_failures++;
+    }
+    expect_row(0, 0, "+- termui -");
+    expect_row(3, 0, "|cells      5  bytes");
+    expect_row(5, 0, "+----------------------------+ ");
+    termui_buffer_destroy(scene);
+}
+
+#ifdef __linux__
+/* Write one evdev event into a pipe standing in for a device */
+static void send_pad_event(int fd, int type, int code, int value) {
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = (unsigned short)type;
+    ev.code = (unsigned short)code;
+    ev.value = value;
+    if (write(fd, &ev, sizeof(ev)) != (ssize_t)sizeof(ev)) {
+        fprintf(stderr, "FAIL: could not write a gamepad event\n");
+        g_failures++;
+    }
+}
+
+/* Release the button 10 ms into a wait */
+static void* release_later(void *arg) {
+    struct timespec delay = { 0, 10 * 1000000L };
+    nanosleep(&delay, NULL);
+    send_pad_event(*(int *)arg, EV_KEY, BTN_SOUTH, 0);
+    send_pad_event(*(int *)arg, EV_SYN, SYN_REPORT, 0);
+    return NULL;
+}
+
+/* Gamepad events are parsed from any fd: a press queues an action,
+ * kernel autorepeat does not, and a release clears the button without
+ * ending a wait */
+static void check_gamepad_pipe(void) {
+    int fds[2];
+    termui_gamepad_t *pad = NULL;
+    if (pipe(fds) == 0) {
+        pad = termui_gamepad_open_fd(fds[0]);
+    }
+    if (!pad) {
+        fprintf(stderr, "FAIL: could not read gamepad events from a pipe\n");
+        g_failures++;
+        return;
+    }
+
+    termui_gamepad_state_t held, released;
+    send_pad_event(fds[1], EV_KEY, BTN_SOUTH, 1);
+    send_pad_event(fds[1], EV_SYN, SYN_REPORT, 0);
+    send_pad_event(fds[1], EV_KEY, BTN_SOUTH, 2);
+    send_pad_event(fds[1], EV_SYN, SYN_REPORT, 0);
+    termui_input_t pressed = termui_input_wait(100);
+    termui_input_t repeated = termui_input_poll();
+    termui_gamepad_get_state(pad, &held);
+
+    pthread_t releaser;
+    pthread_create(&releaser, NULL, release_later, &fds[1]);
+    double start = now_ms();
+    termui_input_t release = termui_input_wait(50);
+    double waited = now_ms() - start;
+    pthread_join(releaser, NULL);
+    termui_gamepad_get_state(pad, &released);
+
+    if (pressed != TERMUI_INPUT_ACTION || repeated != TERMUI_INPUT_NONE || !held.connected ||
+        held.buttons != 1 || released.buttons != 0 || release != TERMUI_INPUT_NONE || waited < 45.0) {
+        fprintf(stderr, "FAIL: gamepad press gave %d then %d, buttons %04x then %04x, "
+                "release ended the wait after %.1f ms\n",
+                (int)pressed, (int)repeated, (unsigned int)held.buttons, (unsigned int)released.buttons,
+                waited);
+        g_failures++;
+    }
+    termui_gamepad_close(pad);
+    close(fds[1]);
+}
+#endif
+
+/* An escape sequence split across reads decodes whole; a lone ESC is
+ * reported once nothing followed it within the delay */
+static void check_escape_split(void) {
+    termui_headless_send_input("\033[A", 3);
+    termui_input_poll();
+    int whole = termui_input_raw_key();
+
+    termui_headless_send_input("\033", 1);
+    termui_input_t held = termui_input_poll();
+    termui_headless_send_input("[A", 2);
+    termui_input_t arrow = termui_input_poll();
+    int key = termui_input_raw_key();
+
+    termui_headless_send_input("\033", 1);
+    double start = now_ms();
+    termui_input_t lone = termui_input_wait(1000);
+    double waited = now_ms() - start;
+
+    if (held != TERMUI_INPUT_NONE || arrow != TERMUI_INPUT_UP || key != whole ||
+        lone != TERMUI_INPUT_QUIT || waited < 50.0 || waited > 500.0) {
+        fprintf(stderr, "FAIL: split escape gave %d then %d (key %d, whole %d), lone ESC %d after %.1f ms\n",
+                (int)held, (int)arrow, key, whole, (int)lone, waited);
+        g_failures++;
+    }
+}
+
+/* Draining reports a resize first, skips unmapped keys, folds held
+ * movement keys into one event with a count, and stamps events in the
+ * order they were read */
+static void check_drain(void) {
+    int width, height;
+    termui_get_size(&width, &height);
+    termui_headless_resize(width, height);
+    termui_headless_send_input("wwkwssw ", 8);
+
+    termui_input_event_t events[8];
+    int count = termui_input_drain(events, 8, TERMUI_DRAIN_COALESCE);
+    termui_check_resize();
+
+    static const termui_input_t want[5] = {
+        TERMUI_INPUT_RESIZE, TERMUI_INPUT_UP, TERMUI_INPUT_DOWN, TERMUI_INPUT_UP, TERMUI_INPUT_ACTION
+    };
+    static const int want_count[5] = { 1, 3, 2, 1, 1 };
+    bool ordered = count == 5;
+    for (int i = 0; ordered && i < count; i++) {
+        ordered = events[i].input == want[i] && events[i].count == want_count[i] &&
+                  (i == 0 || events[i].time_ns >= events[i - 1].time_ns);
+    }
+    if (!ordered || events[1].key != 'w' || events[0].time_ns == 0) {
+        fprintf(stderr, "FAIL: drain gave %d events, expected resize, UP x3, DOWN x2, UP, ACTION\n",
+                count);
+        g_failures++;
+    }
+
+    /* Without coalescing each key is its own event; the rest stay queued */
+    termui_headless_send_input("www", 3);
+    int first = termui_input_drain(events, 2, 0);
+    int rest = termui_input_drain(events + 2, 6, 0);
+    if (first != 2 || rest != 1 || events[0].count != 1 || events[1].count != 1) {
+        fprintf(stderr, "FAIL: uncoalesced drain gave %d then %d events\n", first, rest);
+        g_failures++;
+    }
+    termui_input_wait(0);  /* Take the wakes left by the scripted input */
+}
+
+typedef struct {
+    termui_buffer_t *buf;
+    termui_loop_t *loop;
+} test_state_t;
+
+/* Fixed-rate update: drain input and draw the last action */
+static bool test_update(void *user, double dt) {
+    test_state_t *state = user;
+    (void)dt;
+
+    termui_input_event_t events[32];
+    int count = termui_input_drain(events, 32, TERMUI_DRAIN_COALESCE);
+    for (int i = 0; i < count; i++) {
+        switch (events[i].input) {
+            case TERMUI_INPUT_QUIT:
+                return false;
+
+            case TERMUI_INPUT_UP:
+                termui_buffer_draw_string(state->buf, 25, 9, "UP    ", TERMUI_COLOR_GREEN);
+                break;
+
+            case TERMUI_INPUT_DOWN:
+                termui_buffer_draw_string(state->buf, 25, 9, "DOWN  ", TERMUI_COLOR_GREEN);
+                break;
+
+            case TERMUI_INPUT_LEFT:
+                termui_buffer_draw_string(state->buf, 25, 9, "LEFT  ", TERMUI_COLOR_GREEN);
+                break;
+
+            case TERMUI_INPUT_RIGHT:
+                termui_buffer_draw_string(state->buf, 25, 9, "RIGHT ", TERMUI_COLOR_GREEN);
+                break;
+
+            case TERMUI_INPUT_ACTION:
+                termui_buffer_draw_string(state->buf, 25, 9, "ACTION", TERMUI_COLOR_YELLOW);
+                break;
+
+            case TERMUI_INPUT_RESIZE: {
+                /* Keep the frame; only what the resize uncovered is sent */
+                int width, height;
+                termui_check_resize();
+                termui_get_size(&width, &height);
+                if (termui_buffer_resize(state->buf, width, height) != TERMUI_OK) {
+                    return false;
+                }
+                termui_buffer_draw_string(state->buf, 2, 2, "Resized! Press Q to quit.", TERMUI_COLOR_WHITE);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
     printf("termui v%s - Test Program\n", termui_version());
     printf("Initializing terminal...\n");
 
-    /* Initialize with default config */
-    if (termui_init(NULL) != TERMUI_OK) {
+    /* Default config; --ansi selects the direct escape-sequence backend,
+     * --headless the in-memory screen */
+    termui_config_t config = termui_default_config();
+    bool headless = argc > 1 && strcmp(argv[1], "--headless") == 0;
+    if (argc > 1 && strcmp(argv[1], "--ansi") == 0) {
+        config.backend = TERMUI_BACKEND_ANSI;
+    } else if (headless) {
+        config.backend = TERMUI_BACKEND_HEADLESS;
+    }
+
+    if (termui_init(&config) != TERMUI_OK) {
         fprintf(stderr, "Failed to initialize termui\n");
         return 1;
     }
 
+    /* Gamepad actions arrive with the keyboard's, if one is plugged in */
+    termui_gamepad_t *pad = termui_gamepad_open(NULL);
+
     /* Get terminal size */
     int width, height;
     termui_get_size(&width, &height);
@@ -61,72 +871,68 @@ int main(void) {
     termui_buffer_draw_box(buf, 2, 9, 20, 5, TERMUI_COLOR_YELLOW);
     termui_buffer_draw_string(buf, 4, 11, "Inner content", TERMUI_COLOR_GREEN);
 
+    /* Draw UTF-8 demo */
+    termui_buffer_draw_string(buf, 2, 15, "Unicode:", TERMUI_COLOR_WHITE);
+    termui_buffer_draw_utf8(buf, 11, 15, "caf\xc3\xa9 \xe6\xbc\xa2\xe5\xad\x97 \xe2\xa3\xbf\xe2\xa3\xb6", TERMUI_COLOR_MAGENTA);
+    termui_buffer_draw_box_style(buf, 30, 9, 16, 5, TERMUI_BOX_ROUNDED, TERMUI_COLOR_BLUE);
+
     /* Draw status line */
     termui_buffer_draw_string(buf, 2, height - 2, "Use arrow keys to test input, Q/ESC to quit", TERMUI_COLOR_CYAN);
 
-    /* Render */
-    termui_buffer_render(buf);
-
-    /* Main loop - handle input */
-    int running = 1;
-    while (running) {
-        termui_input_t input = termui_input_poll();
-
-        switch (input) {
-            case TERMUI_INPUT_QUIT:
-                running = 0;
-                break;
-
-            case TERMUI_INPUT_UP:
-                termui_buffer_draw_string(buf, 25, 9, "UP    ", TERMUI_COLOR_GREEN);
-                termui_buffer_render(buf);
-                break;
-
-            case TERMUI_INPUT_DOWN:
-                termui_buffer_draw_string(buf, 25, 9, "DOWN  ", TERMUI_COLOR_GREEN);
-                termui_buffer_render(buf);
-                break;
-
-            case TERMUI_INPUT_LEFT:
-                termui_buffer_draw_string(buf, 25, 9, "LEFT  ", TERMUI_COLOR_GREEN);
-                termui_buffer_render(buf);
-                break;
-
-            case TERMUI_INPUT_RIGHT:
-                termui_buffer_draw_string(buf, 25, 9, "RIGHT ", TERMUI_COLOR_GREEN);
-                termui_buffer_render(buf);
-                break;
-
-            case TERMUI_INPUT_ACTION:
-                termui_buffer_draw_string(buf, 25, 9, "ACTION", TERMUI_COLOR_YELLOW);
-                termui_buffer_render(buf);
-                break;
+    /* Run input at 60 Hz; the loop renders buf only when it changed */
+    termui_loop_t *loop = termui_loop_create(NULL, buf);
+    if (!loop) {
+        fprintf(stderr, "Failed to create frame loop\n");
+        termui_buffer_destroy(buf);
+        termui_cleanup();
+        return 1;
+    }
 
-            case TERMUI_INPUT_RESIZE:
-                /* Handle resize */
-                termui_check_resize();
-                termui_get_size(&width, &height);
-                termui_buffer_destroy(buf);
-                buf = termui_buffer_create(width, height);
-                if (buf) {
-                    termui_buffer_clear(buf);
-                    termui_buffer_draw_string(buf, 2, 2, "Resized! Press Q to quit.", TERMUI_COLOR_WHITE);
-                    termui_buffer_render(buf);
-                }
-                break;
+    /* Headless: press RIGHT, then quit */
+    if (headless) {
+        termui_headless_send_input("\033[Cq", 4);
+    }
 
-            default:
-                break;
-        }
+    test_state_t state = { .buf = buf, .loop = loop };
+    termui_loop_run(loop, test_update, NULL, &state);
+    buf = state.buf;
 
-        /* Small delay to prevent busy-waiting */
-        usleep(16000); /* ~60 FPS */
+    if (headless) {
+        check_headless(buf);
+        check_damage();
+        check_fill();
+        check_diff();
+        check_compositor();
+        check_scroll();
+        check_scroll_narrow();
+        check_replace();
+        check_input_wait();
+        check_render_thread();
+        check_pacing();
+        check_stats_hud();
+#ifdef __linux__
+        check_gamepad_pipe();
+#endif
+        check_escape_split();
+        check_drain();
     }
 
+    termui_loop_stats_t stats;
+    termui_loop_get_stats(loop, &stats);
+    termui_loop_destroy(loop);
+
     /* Cleanup */
+    termui_gamepad_close(pad);
     termui_buffer_destroy(buf);
     termui_cleanup();
 
-    printf("Test complete!\n");
+    printf("Test complete! %llu updates, %llu renders, %llu skipped, %llu missed\n",
+           (unsigned long long)stats.updates, (unsigned long long)stats.renders,
+           (unsigned long long)stats.skipped_renders,
+           (unsigned long long)(stats.missed_updates + stats.missed_renders));
+    if (g_failures > 0) {
+        printf("%d headless check(s) failed\n", g_failures);
+        return 1;
+    }
     return 0;
 }